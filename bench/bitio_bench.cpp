@@ -0,0 +1,123 @@
+/**
+ * Throughput benchmark for BinaryFIn::read_r and
+ * BinaryFOut::write(int, int)
+ *
+ * Writes and reads back a stream of codewords at each width
+ * from 9 to 16 bits, for 64 KiB and 1 MiB block buffers,
+ * one codeword per call and through the span batch APIs
+ * Reported bytes are the packed size, so bytes_per_second is
+ * the MB/s of compressed data moved through the bit I/O layer
+ *
+ * Build:
+ *  g++ -O2 -std=c++20 -Isrc bench/bitio_bench.cpp src/BinaryFIn.cpp src/BinaryFOut.cpp -lbenchmark -lpthread -o bitio_bench
+*/
+
+#include <string>
+#include <vector>
+#include <random>
+#include <filesystem>
+#include <benchmark/benchmark.h>
+
+#include "BinaryFIn.hh"
+#include "BinaryFOut.hh"
+
+static const int CODES = 1 << 20; // Codewords per iteration
+
+static std::string temp_file(){
+    /**
+     * @returns Path of the scratch file used by the benchmarks
+    */
+
+    return (std::filesystem::temp_directory_path() / "bitio_bench.bin").string();
+}
+
+static std::vector<int> make_codes(int r){
+    /**
+     * @param r Width of the codewords
+     * @returns CODES random codewords that fit in r bits
+    */
+
+    std::mt19937 gen(r);
+    std::uniform_int_distribution<int> pick(0, (1 << r) - 1);
+    std::vector<int> codes(CODES);
+    for(auto& c : codes) c = pick(gen);
+    return codes;
+}
+
+static void BM_Write(benchmark::State& state){
+    const int r = state.range(0);
+    const std::vector<int> codes = make_codes(r);
+    const std::string path = temp_file();
+
+    for(auto _ : state){
+        BinaryFOut out(state.range(1));
+        out.initialize(path);
+        for(int c : codes) out.write(c, r);
+        out.close();
+    }
+    state.SetBytesProcessed(state.iterations() * ((static_cast<int64_t>(CODES) * r + 7) / 8));
+}
+
+static void BM_Read(benchmark::State& state){
+    const int r = state.range(0);
+    const std::vector<int> codes = make_codes(r);
+    const std::string path = temp_file();
+    {
+        BinaryFOut out;
+        out.initialize(path);
+        for(int c : codes) out.write(c, r);
+        out.close();
+    }
+
+    for(auto _ : state){
+        BinaryFIn in(state.range(1));
+        in.initialize(path);
+        int sum = 0;
+        for(int i=0; i<CODES; ++i) sum += in.read_r(r);
+        benchmark::DoNotOptimize(sum);
+        in.close();
+    }
+    state.SetBytesProcessed(state.iterations() * ((static_cast<int64_t>(CODES) * r + 7) / 8));
+}
+
+static void BM_WriteBatch(benchmark::State& state){
+    const int r = state.range(0);
+    const std::vector<int> codes = make_codes(r);
+    const std::string path = temp_file();
+
+    for(auto _ : state){
+        BinaryFOut out(state.range(1));
+        out.initialize(path);
+        out.write(std::span<const int>(codes), r);
+        out.close();
+    }
+    state.SetBytesProcessed(state.iterations() * ((static_cast<int64_t>(CODES) * r + 7) / 8));
+}
+
+static void BM_ReadBatch(benchmark::State& state){
+    const int r = state.range(0);
+    std::vector<int> codes = make_codes(r);
+    const std::string path = temp_file();
+    {
+        BinaryFOut out;
+        out.initialize(path);
+        out.write(std::span<const int>(codes), r);
+        out.close();
+    }
+
+    for(auto _ : state){
+        BinaryFIn in(state.range(1));
+        in.initialize(path);
+        benchmark::DoNotOptimize(in.read_r(std::span<int>(codes), r));
+        in.close();
+    }
+    state.SetBytesProcessed(state.iterations() * ((static_cast<int64_t>(CODES) * r + 7) / 8));
+}
+
+BENCHMARK(BM_Write)->ArgsProduct({benchmark::CreateDenseRange(9, 16, 1), {1 << 16, 1 << 20}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Read)->ArgsProduct({benchmark::CreateDenseRange(9, 16, 1), {1 << 16, 1 << 20}})->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_WriteBatch)->ArgsProduct({benchmark::CreateDenseRange(9, 16, 1), {1 << 16, 1 << 20}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ReadBatch)->ArgsProduct({benchmark::CreateDenseRange(9, 16, 1), {1 << 16, 1 << 20}})->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,455 @@
+/**
+ * Corpus benchmark for the whole codec
+ *
+ * Runs LZW compression and expansion, DLB dictionary operations and
+ * BinaryFIn/BinaryFOut bit I/O over a generated corpus of text, log
+ * lines, JSON records, structured binary, random bytes and zeros
+ * Every benchmark reports throughput (bytes_per_second) and the
+ * process's peak resident memory during its timed loop (peak_rss_mb),
+ * which includes the whole corpus (24 MiB); codec benchmarks also
+ * report the compression ratio. Block compression runs on a worker thread even with one
+ * thread, so codec benchmarks are timed by wall clock
+ * Codec benchmarks cover one stream, 1 MiB blocks, 1 MiB blocks with
+ * Huffman coded codewords, and one stream with sync points, whose
+ * ratio shows what the sync points cost, then 1 MiB blocks at each
+ * compression effort, which trades compression speed for ratio
+ * Small message benchmarks compress 2 KiB messages one at a time,
+ * from the single characters and from a dictionary trained on
+ * other messages of the same kind, with LZW::compress and LZW::expand
+ * or with one LZWContext reused for every message
+ *
+ * Compare builds from the JSON report:
+ *  ./corpus_bench --benchmark_out=corpus.json --benchmark_out_format=json
+ * (the CMake target bench_json writes it to the build directory)
+ *
+ * Build:
+ *  cmake -S . -B build -DCMAKE_BUILD_TYPE=Release && cmake --build build --target corpus_bench
+*/
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <span>
+#include <random>
+#include <fstream>
+#include <cstdint>
+#include <cstdio>
+#include <sys/resource.h>
+#include <benchmark/benchmark.h>
+
+#include "LZW.hh"
+#include "LZWContext.hh"
+#include "DLB.hh"
+#include "ArenaDLB.hh"
+#include "BinaryFIn.hh"
+#include "BinaryFOut.hh"
+
+static const std::size_t SIZE = 1 << 22; // Bytes of each corpus file
+static const std::size_t DLB_SIZE = 1 << 18; // Bytes driven through the string tries, which are slower
+static const std::size_t MESSAGE = 1 << 11; // Bytes of each small message
+static const std::size_t MESSAGES = 1 << 18; // Bytes of small messages, after the training sample
+static const std::size_t SAMPLE = 1 << 18; // Bytes a dictionary is trained on
+static const int SMALL_WIDTH = 12; // Codeword width of small messages
+
+enum Kind{TEXT, LOGS, JSON, BINARY, RANDOM, ZEROS};
+static const char* KIND_NAMES[] = {"text", "logs", "json", "binary", "random", "zeros"};
+
+static std::vector<std::byte> make_corpus(Kind kind, std::size_t size){
+    /**
+     * Generates deterministic sample input of one kind
+     *
+     * @param kind  Kind of data to generate
+     * @param size  Number of bytes to generate
+     * @returns size bytes of input
+    */
+
+    static const char* words[] = {
+        "the", "of", "and", "to", "in", "a", "is", "that", "for", "it",
+        "as", "was", "with", "be", "by", "on", "not", "he", "this", "are",
+        "compression", "dictionary", "codeword", "trie", "prefix", "string"
+    };
+    static const char* levels[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR"};
+    static const char* paths[] = {"/api/v1/users", "/api/v1/orders", "/static/app.js", "/health", "/login"};
+    std::mt19937 gen(42);
+    auto pick = [&](int n){ return static_cast<int>(gen() % n); };
+
+    std::string s;
+    s.reserve(size + 256);
+    char line[256];
+
+    while(s.size() < size){
+        switch(kind){
+            case TEXT:
+                s += words[pick(26)];
+                s += ' ';
+                break;
+            case LOGS:{
+                // Timestamped request lines, as a web server would write
+                static uint64_t ms = 1700000000000;
+                ms += gen() % 50;
+                std::snprintf(line, sizeof line, "%llu %s [worker-%d] GET %s status=%d bytes=%d latency_ms=%d\n",
+                    static_cast<unsigned long long>(ms), levels[pick(6)], pick(8), paths[pick(5)],
+                    pick(10) == 0 ? 500 : 200, pick(100000), pick(300));
+                s += line;
+                break;
+            }
+            case JSON:{
+                static int id = 0;
+                std::snprintf(line, sizeof line,
+                    "{\"id\":%d,\"name\":\"%s %s\",\"active\":%s,\"score\":%d.%02d,\"tags\":[\"%s\",\"%s\"]},\n",
+                    id++, words[pick(26)], words[pick(26)], pick(2) ? "true" : "false",
+                    pick(1000), pick(100), words[pick(26)], words[pick(26)]);
+                s += line;
+                break;
+            }
+            case BINARY:{
+                // 16-byte records: a counter, a slowly drifting value and a flag word
+                static uint32_t id = 0;
+                static int32_t value = 0;
+                value += static_cast<int32_t>(gen() % 17) - 8;
+                const uint32_t record[4] = {id++, static_cast<uint32_t>(value), static_cast<uint32_t>(gen() % 4), 0};
+                s.append(reinterpret_cast<const char*>(record), sizeof record);
+                break;
+            }
+            case RANDOM:
+                s += static_cast<char>(gen());
+                break;
+            case ZEROS:
+                s.resize(size, '\0');
+                break;
+        }
+    }
+
+    s.resize(size);
+    const std::byte* b = reinterpret_cast<const std::byte*>(s.data());
+    return std::vector<std::byte>(b, b + s.size());
+}
+
+static const std::vector<std::byte>& corpus(int kind){
+    /**
+     * The whole corpus is generated on first use, so it is
+     * resident for every peak memory measurement alike
+     *
+     * @param kind  Kind of data
+     * @returns The corpus file of that kind
+    */
+
+    static std::vector<std::byte> files[ZEROS + 1];
+    if(files[kind].empty()){
+        for(int k=TEXT; k<=ZEROS; ++k) files[k] = make_corpus(static_cast<Kind>(k), SIZE);
+    }
+    return files[kind];
+}
+
+static double status_mb(const std::string& field){
+    /**
+     * @param field Name of a memory field of /proc/self/status, with its colon
+     * @returns Value of the field in MiB, 0 if it is not there
+    */
+
+    std::ifstream status("/proc/self/status");
+    std::string key;
+    while(status >> key){
+        if(key == field){
+            double kb = 0;
+            status >> kb;
+            return kb / 1024;
+        }
+        status.ignore(1 << 10, '\n');
+    }
+    return 0;
+}
+
+static void reset_peak_rss(){
+    /**
+     * Starts a new peak resident memory measurement
+     * Linux resets the peak (VmHWM) to the current resident size
+     * when 5 is written to clear_refs; elsewhere the peak is the
+     * process lifetime maximum from getrusage
+    */
+
+    std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+static double peak_rss_mb(){
+    /**
+     * @returns Peak resident memory in MiB since reset_peak_rss()
+    */
+
+    const double peak = status_mb("VmHWM:");
+    if(peak > 0) return peak;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+static LZWOptions options_for(benchmark::State& state){
+    /**
+     * @returns Compression settings for a codec benchmark, one thread,
+     *  the block size given as the benchmark's second argument, the
+     *  sync interval as its third, Huffman coding as its fourth and
+     *  the effort as its fifth
+    */
+
+    LZWOptions options;
+    options.block_size = state.range(1);
+    options.sync_interval = state.range(2);
+    options.huffman = state.range(3);
+    options.effort = state.range(4);
+    options.threads = 1;
+    return options;
+}
+
+static void BM_Compress(benchmark::State& state){
+    const std::vector<std::byte>& data = corpus(state.range(0));
+    const LZWOptions options = options_for(state);
+    state.SetLabel(KIND_NAMES[state.range(0)]);
+
+    std::size_t compressed = 0;
+    reset_peak_rss();
+    for(auto _ : state){
+        std::vector<std::byte> out = LZW::compress(data, options);
+        compressed = out.size();
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+    state.counters["ratio"] = static_cast<double>(data.size()) / compressed;
+    state.counters["peak_rss_mb"] = peak_rss_mb();
+}
+
+static LZWOptions small_options(benchmark::State& state){
+    /**
+     * @returns Compression settings for one small message, from the
+     *  dictionary trained on the first SAMPLE bytes of the benchmark's
+     *  kind of data when its second argument is set
+    */
+
+    static std::optional<LZWDictionary> trained[ZEROS + 1];
+    LZWOptions options;
+    options.block_size = 0;
+    options.max_width = SMALL_WIDTH;
+    options.threads = 1;
+    if(state.range(1)){
+        std::optional<LZWDictionary>& d = trained[state.range(0)];
+        if(!d) d.emplace(LZWDictionary::train(std::span(corpus(state.range(0))).first(SAMPLE), SMALL_WIDTH));
+        options.dictionary = &*d;
+    }
+    return options;
+}
+
+static void BM_CompressSmall(benchmark::State& state){
+    const std::span<const std::byte> data = std::span(corpus(state.range(0))).subspan(SAMPLE, MESSAGES);
+    const LZWOptions options = small_options(state);
+    state.SetLabel(KIND_NAMES[state.range(0)]);
+
+    LZWContext context(options);
+    std::size_t compressed = 0;
+    reset_peak_rss();
+    for(auto _ : state){
+        compressed = 0;
+        for(std::size_t at=0; at<data.size(); at+=MESSAGE){
+            if(state.range(2)){
+                std::span<const std::byte> out = context.compress(data.subspan(at, MESSAGE));
+                compressed += out.size();
+                benchmark::DoNotOptimize(out.data());
+            }
+            else{
+                std::vector<std::byte> out = LZW::compress(data.subspan(at, MESSAGE), options);
+                compressed += out.size();
+                benchmark::DoNotOptimize(out.data());
+            }
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+    state.counters["ratio"] = static_cast<double>(data.size()) / compressed;
+    state.counters["peak_rss_mb"] = peak_rss_mb();
+}
+
+static void BM_ExpandSmall(benchmark::State& state){
+    const std::span<const std::byte> data = std::span(corpus(state.range(0))).subspan(SAMPLE, MESSAGES);
+    const LZWOptions options = small_options(state);
+    std::vector<std::vector<std::byte>> messages;
+    for(std::size_t at=0; at<data.size(); at+=MESSAGE){
+        messages.push_back(LZW::compress(data.subspan(at, MESSAGE), options));
+    }
+    state.SetLabel(KIND_NAMES[state.range(0)]);
+
+    LZWContext context(options);
+    reset_peak_rss();
+    for(auto _ : state){
+        for(const std::vector<std::byte>& m : messages){
+            if(state.range(2)){
+                benchmark::DoNotOptimize(context.expand(m).data());
+            }
+            else{
+                std::vector<std::byte> out = LZW::expand(m, 1, options.dictionary);
+                benchmark::DoNotOptimize(out.data());
+            }
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+    state.counters["peak_rss_mb"] = peak_rss_mb();
+}
+
+static void BM_Expand(benchmark::State& state){
+    const std::vector<std::byte>& data = corpus(state.range(0));
+    const std::vector<std::byte> compressed = LZW::compress(data, options_for(state));
+    state.SetLabel(KIND_NAMES[state.range(0)]);
+
+    reset_peak_rss();
+    for(auto _ : state){
+        std::vector<std::byte> out = LZW::expand(compressed, 1);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+    state.counters["ratio"] = static_cast<double>(data.size()) / compressed.size();
+    state.counters["peak_rss_mb"] = peak_rss_mb();
+}
+
+template<class Trie>
+static void BM_DictOps(benchmark::State& state){
+    /**
+     * Drives a string trie the way LZW compression does: seed the
+     * 256 single characters, then prefix match, fetch the key and
+     * insert the match extended by one character, up to 4096 keys
+    */
+
+    const std::vector<std::byte>& data = corpus(state.range(0));
+    const std::string text(reinterpret_cast<const char*>(data.data()), DLB_SIZE);
+    state.SetLabel(KIND_NAMES[state.range(0)]);
+
+    reset_peak_rss();
+    for(auto _ : state){
+        Trie st;
+        for(int i=0; i<256; ++i) st.put(static_cast<char>(i), i);
+        int code = 257;
+        std::size_t t = 0;
+        while(t < text.length()){
+            std::string s = st.longest_prefix_of(text.substr(t, 64));
+            benchmark::DoNotOptimize(st.get(s));
+            if(t + s.length() < text.length() && code < 4096){
+                st.put(text.substr(t, s.length()+1), code);
+                code++;
+            }
+            t += s.length();
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * text.length());
+    state.counters["peak_rss_mb"] = peak_rss_mb();
+}
+
+static void BM_BitWrite(benchmark::State& state){
+    /**
+     * Writes every corpus byte as an r-bit codeword to memory
+    */
+
+    const std::vector<std::byte>& data = corpus(state.range(0));
+    const int r = state.range(1);
+    std::vector<int> codes(data.size());
+    for(std::size_t i=0; i<data.size(); ++i) codes[i] = static_cast<int>(data[i]) << (r - 8);
+    state.SetLabel(KIND_NAMES[state.range(0)]);
+
+    std::vector<unsigned char> out;
+    out.reserve(data.size() * r / 8 + 16);
+    reset_peak_rss();
+    for(auto _ : state){
+        out.clear();
+        BinaryFOut bits;
+        bits.initialize(out);
+        bits.write(std::span<const int>(codes), r);
+        bits.close();
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * out.size());
+    state.counters["peak_rss_mb"] = peak_rss_mb();
+}
+
+static void BM_BitRead(benchmark::State& state){
+    /**
+     * Reads back every corpus byte as an r-bit codeword from memory
+    */
+
+    const std::vector<std::byte>& data = corpus(state.range(0));
+    const int r = state.range(1);
+    std::vector<int> codes(data.size());
+    for(std::size_t i=0; i<data.size(); ++i) codes[i] = static_cast<int>(data[i]) << (r - 8);
+    state.SetLabel(KIND_NAMES[state.range(0)]);
+
+    std::vector<unsigned char> packed;
+    BinaryFOut bits;
+    bits.initialize(packed);
+    bits.write(std::span<const int>(codes), r);
+    bits.close();
+
+    reset_peak_rss();
+    for(auto _ : state){
+        BinaryFIn in;
+        in.initialize(std::span<const unsigned char>(packed));
+        benchmark::DoNotOptimize(in.read_r(std::span<int>(codes), r));
+    }
+    state.SetBytesProcessed(state.iterations() * packed.size());
+    state.counters["peak_rss_mb"] = peak_rss_mb();
+}
+
+static void codec_arguments(benchmark::internal::Benchmark* b){
+    /**
+     * Every kind of data as one stream, in 1 MiB blocks with and
+     * without Huffman coding, as one stream with a sync point
+     * every 16384 codewords, and in 1 MiB blocks at efforts 1 to 16
+    */
+
+    b->ArgNames({"kind", "block_size", "sync", "huffman", "effort"});
+    for(int kind=TEXT; kind<=ZEROS; ++kind){
+        b->Args({kind, 0, 0, 0, 0});
+        b->Args({kind, 1 << 20, 0, 0, 0});
+        b->Args({kind, 1 << 20, 0, 1, 0});
+        b->Args({kind, 0, 1 << 14, 0, 0});
+        for(int effort : {1, 2, 4, 8, 16}) b->Args({kind, 1 << 20, 0, 0, effort});
+    }
+}
+
+static void small_arguments(benchmark::internal::Benchmark* b){
+    /**
+     * Every kind of data, without and with a trained dictionary,
+     * through the static calls and through a reused context
+    */
+
+    b->ArgNames({"kind", "primed", "context"});
+    for(int kind=TEXT; kind<=ZEROS; ++kind){
+        for(int primed : {0, 1}){
+            for(int context : {0, 1}) b->Args({kind, primed, context});
+        }
+    }
+}
+
+static void kind_arguments(benchmark::internal::Benchmark* b){
+    /**
+     * Every kind of data
+    */
+
+    b->ArgNames({"kind"});
+    for(int kind=TEXT; kind<=ZEROS; ++kind) b->Args({kind});
+}
+
+static void bit_arguments(benchmark::internal::Benchmark* b){
+    /**
+     * Every kind of data at the narrowest and widest usual codeword widths
+    */
+
+    b->ArgNames({"kind", "width"});
+    for(int kind=TEXT; kind<=ZEROS; ++kind){
+        for(int width : {9, 16}) b->Args({kind, width});
+    }
+}
+
+BENCHMARK(BM_Compress)->Apply(codec_arguments)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_Expand)->Apply(codec_arguments)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_CompressSmall)->Apply(small_arguments)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ExpandSmall)->Apply(small_arguments)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_DictOps, DLB)->Apply(kind_arguments)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_DictOps, ArenaDLB)->Apply(kind_arguments)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BitWrite)->Apply(bit_arguments)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BitRead)->Apply(bit_arguments)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,149 @@
+/**
+ * Compression throughput of the encoder dictionaries:
+ * LZW (ArenaDLB trie), HashLZW (HashDict hash table) and
+ * SimdLZW (SimdDLB trie with vector-searched children) and
+ * PoolLZW (PoolDLB trie of 8-byte nodes in a fixed pool)
+ *
+ * Each compresses 4 MiB of text, structured binary and random
+ * bytes in memory as one stream on one thread, at max widths of
+ * 12 and 16 bits, so only the dictionary differs between runs
+ * All produce identical output
+ *
+ * Each also compresses 2 KiB text messages through one reused
+ * context with a dictionary trained on 256 KiB of the same text,
+ * at 12 and 16 bits, so each message also pays for restoring
+ * the trained entries into the symbol table
+ *
+ * Build:
+ *  g++ -O2 -std=c++20 -Isrc bench/dict_bench.cpp src/BinaryFIn.cpp src/BinaryFOut.cpp src/ArenaDLB.cpp src/HashDict.cpp src/SimdDLB.cpp src/PoolDLB.cpp src/LZWHeader.cpp src/LZWEncoder.cpp src/LZWDecoder.cpp src/LZWStats.cpp src/LZWDictionary.cpp src/LZWEntropy.cpp src/LZWContext.cpp src/LZW.cpp -lbenchmark -lpthread -o dict_bench
+*/
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <cstring>
+#include <benchmark/benchmark.h>
+
+#include "LZW.hh"
+#include "LZWContext.hh"
+
+static const std::size_t SIZE = 1 << 22; // Bytes compressed per iteration
+
+enum Kind{TEXT, BINARY, RANDOM};
+
+static std::vector<std::byte> make_data(Kind kind){
+    /**
+     * Generates deterministic sample input
+     *
+     * @param kind  TEXT for English-like words, BINARY for records of
+     *  small integers and flags, RANDOM for uniform bytes
+     * @returns SIZE bytes of input
+    */
+
+    static const char* words[] = {
+        "the", "of", "and", "to", "in", "a", "is", "that", "for", "it",
+        "as", "was", "with", "be", "by", "on", "not", "he", "this", "are",
+        "compression", "dictionary", "codeword", "trie", "prefix", "string"
+    };
+    std::mt19937 gen(42);
+    std::vector<std::byte> data;
+    data.reserve(SIZE + 16);
+
+    if(kind == TEXT){
+        std::uniform_int_distribution<int> pick(0, sizeof(words)/sizeof(words[0]) - 1);
+        while(data.size() < SIZE){
+            for(const char* w = words[pick(gen)]; *w; ++w) data.push_back(std::byte(*w));
+            data.push_back(std::byte(' '));
+        }
+    }
+    else if(kind == BINARY){
+        // 16-byte records: a counter, a slowly drifting value and a flag word
+        uint32_t id = 0;
+        int32_t value = 0;
+        while(data.size() < SIZE){
+            value += static_cast<int32_t>(gen() % 17) - 8;
+            const uint32_t record[4] = {id++, static_cast<uint32_t>(value), static_cast<uint32_t>(gen() % 4), 0};
+            const std::byte* b = reinterpret_cast<const std::byte*>(record);
+            data.insert(data.end(), b, b + sizeof record);
+        }
+    }
+    else{
+        while(data.size() < SIZE) data.push_back(std::byte(gen()));
+    }
+
+    data.resize(SIZE);
+    return data;
+}
+
+template<class Codec>
+static void BM_Compress(benchmark::State& state){
+    const std::vector<std::byte> data = make_data(static_cast<Kind>(state.range(0)));
+    LZWOptions options;
+    options.max_width = state.range(1);
+    options.block_size = 0;
+    options.threads = 1;
+
+    std::size_t compressed = 0;
+    for(auto _ : state){
+        std::vector<std::byte> out = Codec::compress(data, options);
+        compressed = out.size();
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+    state.counters["ratio"] = static_cast<double>(data.size()) / compressed;
+}
+
+template<class Context>
+static void BM_Primed(benchmark::State& state){
+    /**
+     * Small messages through one reused context with a trained
+     * dictionary, so every message starts by restoring the
+     * dictionary's entries into the symbol table
+    */
+
+    static const std::size_t MESSAGE = 2048; // Bytes per message
+    static const std::size_t SAMPLE = 1 << 18; // Bytes trained on
+    const std::vector<std::byte> data = make_data(TEXT);
+    const std::span<const std::byte> sample(data.data(), SAMPLE);
+    const LZWDictionary dictionary = LZWDictionary::train(sample, state.range(0));
+    LZWOptions options;
+    options.max_width = state.range(0);
+    options.dictionary = &dictionary;
+    Context context(options);
+
+    std::size_t at = SAMPLE, raw = 0, compressed = 0;
+    for(auto _ : state){
+        if(at + MESSAGE > data.size()) at = SAMPLE;
+        const std::span<const std::byte> out = context.compress(std::span<const std::byte>(data.data() + at, MESSAGE));
+        benchmark::DoNotOptimize(out.data());
+        raw += MESSAGE;
+        compressed += out.size();
+        at += MESSAGE;
+    }
+    state.SetBytesProcessed(state.iterations() * MESSAGE);
+    state.counters["ratio"] = static_cast<double>(raw) / compressed;
+}
+
+static void arguments(benchmark::internal::Benchmark* b){
+    /**
+     * Every kind of data at each max width
+    */
+
+    b->ArgNames({"kind", "max_width"});
+    for(int kind : {TEXT, BINARY, RANDOM}){
+        for(int width : {12, 16}) b->Args({kind, width});
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_Compress, LZW)->Apply(arguments)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Compress, HashLZW)->Apply(arguments)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Compress, SimdLZW)->Apply(arguments)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Compress, PoolLZW)->Apply(arguments)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_Primed, LZWContext)->ArgName("max_width")->Arg(12)->Arg(16)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Primed, HashLZWContext)->ArgName("max_width")->Arg(12)->Arg(16)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Primed, SimdLZWContext)->ArgName("max_width")->Arg(12)->Arg(16)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Primed, PoolLZWContext)->ArgName("max_width")->Arg(12)->Arg(16)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
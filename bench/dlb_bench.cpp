@@ -0,0 +1,146 @@
+/**
+ * Benchmark comparing the shared_ptr-linked DLB with the
+ * arena-backed ArenaDLB and SimdDLB
+ *
+ * Each trie is driven the way LZW compression drives it:
+ * seed the 256 single characters, then repeatedly prefix match,
+ * fetch the key and insert the match extended by one character
+ *
+ * Build:
+ *  g++ -O2 -std=c++20 -Isrc bench/dlb_bench.cpp src/DLB.cpp src/ArenaDLB.cpp src/SimdDLB.cpp -lbenchmark -lpthread -o dlb_bench
+*/
+
+#include <string>
+#include <random>
+#include <benchmark/benchmark.h>
+
+#include "DLB.hh"
+#include "ArenaDLB.hh"
+#include "SimdDLB.hh"
+
+static const int R = 256; // Number of input characters
+static const int L = 4096; // Number of codewords
+static const std::size_t WINDOW = 64; // Longest prefix the driver will look for
+
+static std::string make_text(std::size_t length){
+    /**
+     * Generates deterministic English-like text
+     *
+     * @param length    Number of characters to generate
+     * @returns Generated text
+    */
+
+    static const char* words[] = {
+        "the", "of", "and", "to", "in", "a", "is", "that", "for", "it",
+        "as", "was", "with", "be", "by", "on", "not", "he", "this", "are",
+        "compression", "dictionary", "codeword", "trie", "prefix", "string"
+    };
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> pick(0, sizeof(words)/sizeof(words[0]) - 1);
+
+    std::string text;
+    text.reserve(length + 16);
+    while(text.length() < length){
+        text += words[pick(gen)];
+        text += ' ';
+    }
+    text.resize(length);
+    return text;
+}
+
+template<class Trie>
+static void seed(Trie& st){
+    /**
+     * Inserts all single characters as LZW does before compressing
+    */
+
+    for(int i=0; i<R; ++i) st.put(static_cast<char>(i), i);
+}
+
+template<class Trie>
+static void BM_Build(benchmark::State& state){
+    /**
+     * Builds a full LZW dictionary over the sample text
+    */
+
+    const std::string text = make_text(state.range(0));
+    for(auto _ : state){
+        Trie st;
+        seed(st);
+        int code = R+1;
+        std::size_t t = 0;
+        while(t < text.length()){
+            std::string s = st.longest_prefix_of(text.substr(t, WINDOW));
+            benchmark::DoNotOptimize(st.get(s));
+            if(t + s.length() < text.length() && code < L){
+                st.put(text.substr(t, s.length()+1), code);
+                code++;
+            }
+            t += s.length();
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * text.length());
+}
+
+template<class Trie>
+static void BM_Get(benchmark::State& state){
+    /**
+     * Looks up every word of the sample text in a dictionary
+     * holding all of them
+    */
+
+    const std::string text = make_text(1 << 16);
+    std::vector<std::string> keys;
+    Trie st;
+    seed(st);
+    int code = R+1;
+    for(std::size_t t=0; t+8<=text.length() && code < L; t+=8){
+        keys.push_back(text.substr(t, 8));
+        st.put(keys.back(), code++);
+    }
+
+    std::size_t bytes = 0;
+    for(auto _ : state){
+        for(auto& k : keys){
+            benchmark::DoNotOptimize(st.get(k));
+            bytes += k.length();
+        }
+    }
+    state.SetBytesProcessed(bytes);
+}
+
+static void BM_ArenaDLB_Reset(benchmark::State& state){
+    /**
+     * Clears and reseeds one arena, as LZW does on dictionary reset
+    */
+
+    ArenaDLB st(L);
+    for(auto _ : state){
+        st.clear();
+        seed(st);
+        benchmark::DoNotOptimize(st.size());
+    }
+}
+
+static void BM_DLB_Reset(benchmark::State& state){
+    /**
+     * The DLB has no clear, so a reset means building a new one
+    */
+
+    for(auto _ : state){
+        DLB st;
+        seed(st);
+        benchmark::DoNotOptimize(&st);
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_Build, DLB)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_Build, ArenaDLB)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_Build, SimdDLB)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_Get, DLB);
+BENCHMARK_TEMPLATE(BM_Get, ArenaDLB);
+BENCHMARK_TEMPLATE(BM_Get, SimdDLB);
+BENCHMARK(BM_DLB_Reset);
+BENCHMARK(BM_ArenaDLB_Reset);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,94 @@
+/**
+ * Latency benchmark for LZW::expand_range
+ *
+ * Compresses generated text of 4, 16 and 64 MiB in 1 MiB blocks,
+ * then expands 4 KiB ranges at random offsets, and for comparison
+ * the whole file with expand()
+ * expand_range should take the same time at every archive size,
+ * since it only decodes the block(s) covering the range,
+ * while expand() grows with the archive
+ *
+ * LZW works on fixed file names in the current directory, so the
+ * benchmark runs in its own scratch directory
+ * Blocks are decoded on worker threads, so wall time is reported
+ *
+ * Build:
+ *  g++ -O2 -std=c++20 -Isrc bench/range_bench.cpp src/BinaryFIn.cpp src/BinaryFOut.cpp src/ArenaDLB.cpp src/HashDict.cpp src/SimdDLB.cpp src/PoolDLB.cpp src/LZWHeader.cpp src/LZWEncoder.cpp src/LZWDecoder.cpp src/LZWStats.cpp src/LZWDictionary.cpp src/LZWEntropy.cpp src/LZW.cpp -lbenchmark -lpthread -o range_bench
+*/
+
+#include <string>
+#include <fstream>
+#include <random>
+#include <filesystem>
+#include <benchmark/benchmark.h>
+
+#include "LZW.hh"
+
+static const std::size_t RANGE = 4096; // Bytes expanded per range
+
+static void make_archive(std::size_t length){
+    /**
+     * Writes length bytes of English-like text to "input.txt" in
+     * the scratch directory and compresses it to "compress.lzw"
+     * Does nothing if the archive for this length is already there
+     *
+     * @param length    Number of bytes to compress
+    */
+
+    static std::size_t current = 0; // Length of the archive on disk
+
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "range_bench";
+    std::filesystem::create_directories(dir);
+    std::filesystem::current_path(dir);
+    if(current == length) return;
+
+    static const char* words[] = {
+        "the", "of", "and", "to", "in", "a", "is", "that", "for", "it",
+        "as", "was", "with", "be", "by", "on", "not", "he", "this", "are",
+        "compression", "dictionary", "codeword", "trie", "prefix", "string"
+    };
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> pick(0, sizeof(words)/sizeof(words[0]) - 1);
+
+    std::string text;
+    text.reserve(length + 16);
+    while(text.length() < length){
+        text += words[pick(gen)];
+        text += ' ';
+    }
+    text.resize(length);
+    std::ofstream("input.txt", std::ios::binary).write(text.data(), text.length());
+
+    LZW lzw("input.txt");
+    lzw.compress();
+    current = length;
+}
+
+static void BM_ExpandRange(benchmark::State& state){
+    const std::size_t length = static_cast<std::size_t>(state.range(0)) << 20;
+    make_archive(length);
+
+    LZW lzw("compress.lzw");
+    std::mt19937_64 gen(1);
+    std::uniform_int_distribution<std::size_t> pick(0, length - RANGE);
+    for(auto _ : state){
+        benchmark::DoNotOptimize(lzw.expand_range(pick(gen), RANGE));
+    }
+    state.SetBytesProcessed(state.iterations() * RANGE);
+}
+
+static void BM_Expand(benchmark::State& state){
+    const std::size_t length = static_cast<std::size_t>(state.range(0)) << 20;
+    make_archive(length);
+
+    LZW lzw("input.txt");
+    for(auto _ : state){
+        lzw.expand();
+    }
+    state.SetBytesProcessed(state.iterations() * length);
+}
+
+BENCHMARK(BM_ExpandRange)->Arg(4)->Arg(16)->Arg(64)->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK(BM_Expand)->Arg(4)->Arg(16)->Arg(64)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
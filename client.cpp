@@ -21,6 +21,11 @@ int main(int argc, char** argv){
 
     LZW lzw("big.txt");
 
-    lzw.compress();
-    lzw.expand();
+    LZWStats compressed = lzw.compress();
+    LZWStats expanded = lzw.expand();
+
+    // --stats dumps what both runs measured as JSON
+    if(argc > 1 && std::string(argv[1]) == "--stats"){
+        std::cout << "{\"compress\": " << compressed.json() << ", \"expand\": " << expanded.json() << "}" << std::endl;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,298 @@
+/**
+ * lzw: command line compressor
+ *
+ * usage: lzw [-c | -d | -t | --train] [options] [file]
+ *
+ * Compresses (-c, the default) or expands (-d) file, or standard input
+ * when file is "-" or missing, and tests (-t) that a compressed file
+ * expands cleanly without writing it anywhere
+ * Output goes to -o, or by default to standard output for standard
+ * input, to file.lzw when compressing a file and to file without its
+ * .lzw suffix when expanding one, so any number of jobs can run side
+ * by side in one directory or in a pipeline
+ *
+ * Small messages compress far better from a trained dictionary:
+ * --train learns one from a sample of typical messages and writes
+ * it to -o, or file.dict, and -D gives it to compression and again
+ * to expansion, which fails without it
+ *
+ * -H Huffman codes each block's codewords for a few percent more
+ * compression; it is recorded in the file, so -d needs no flag
+ * -e trades compression speed for ratio; the file expands as usual
+ *
+ * Exit status is 0 on success, 1 on any error and 2 on bad usage;
+ * a partly written output file is removed on error
+*/
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <optional>
+#include <iterator>
+#include <cstdint>
+#include <stdexcept>
+
+#include "src/LZW.hh"
+
+static const char* USAGE =
+    "usage: lzw [-c | -d | -t | --train] [options] [file]\n"
+    "  -c            compress (default)\n"
+    "  -d            expand\n"
+    "  -t            test that a compressed file expands cleanly\n"
+    "  --train       learn a dictionary from file, a sample of small messages,\n"
+    "                for codewords of -W bits (default 12)\n"
+    "  -o path       output file, - for standard output\n"
+    "  -T threads    worker threads for blocks (default: one per core)\n"
+    "  -W width      largest codeword width in bits, 9 to 20 (default 16)\n"
+    "  -B bytes      block size, 0 for one stream (default 1048576)\n"
+    "  -S codewords  one stream with a sync point every so many codewords,\n"
+    "                so it still expands in parallel (default none)\n"
+    "  -H            Huffman code each block's codewords, for a smaller file\n"
+    "                that expands a little slower (needs -B above 0)\n"
+    "  -e effort     try up to so many shorter matches at each codeword, 0 to 16,\n"
+    "                for a smaller file that compresses slower (default 0)\n"
+    "  -D dictfile   start from a dictionary made by --train; files compressed\n"
+    "                with one need it to expand, and take its -W\n"
+    "  -f            overwrite an existing output file\n"
+    "  -s, --stats   print statistics as JSON to standard error\n"
+    "  -h, --help    show this help\n"
+    "file is read from standard input when it is - or missing\n";
+
+class NullBuffer : public std::streambuf{
+    /**
+     * Stream buffer that discards everything written to it,
+     * for testing without keeping the output
+    */
+
+    protected:
+        int overflow(int c) override{ return c == traits_type::eof() ? 0 : c; }
+        std::streamsize xsputn(const char*, std::streamsize n) override{ return n; }
+};
+
+static unsigned long number(const std::string& flag, const char* value){
+    /**
+     * Parses the value of a numeric option
+     *
+     * @param flag  Option the value belongs to, for the error message
+     * @param value Text of the value
+     * @returns The value
+     * @throws invalid_argument if value is not a whole number
+    */
+
+    std::size_t used = 0;
+    unsigned long n = 0;
+    try{
+        n = std::stoul(value, &used);
+    }
+    catch(const std::exception&){
+        used = 0;
+    }
+    if(used == 0 || value[used] != '\0' || value[0] == '-'){
+        throw(std::invalid_argument(flag + " needs a whole number, not '" + value + "'"));
+    }
+    return n;
+}
+
+static std::vector<std::byte> slurp(std::istream& in){
+    /**
+     * @param in    Stream to read to its end
+     * @returns Every byte of in
+     * @throws ifstream::failure if reading fails
+    */
+
+    std::vector<std::byte> bytes;
+    std::vector<char> chunk(1 << 16);
+    while(in.read(chunk.data(), chunk.size()) || in.gcount() > 0){
+        const std::byte* got = reinterpret_cast<const std::byte*>(chunk.data());
+        bytes.insert(bytes.end(), got, got + in.gcount());
+    }
+    if(in.bad()) throw(std::ifstream::failure("Failed to read the input"));
+    return bytes;
+}
+
+static std::string default_output(const std::string& input, char mode){
+    /**
+     * @param input Name of the input file
+     * @param mode  'c' to compress, 'd' to expand or 'p' to train a dictionary
+     * @returns Output file name used when -o is not given
+    */
+
+    if(mode == 'c') return input + ".lzw";
+    if(mode == 'p') return input + ".dict";
+    const std::string suffix = ".lzw";
+    if(input.size() > suffix.size() && input.compare(input.size() - suffix.size(), suffix.size(), suffix) == 0){
+        return input.substr(0, input.size() - suffix.size());
+    }
+    return input + ".out";
+}
+
+int main(int argc, char** argv){
+    std::ios::sync_with_stdio(false);
+
+    char mode = 'c';
+    std::string input = "-";
+    std::string output;
+    bool force = false;
+    bool stats = false;
+    bool have_input = false;
+    bool have_block_size = false;
+    bool have_width = false;
+    std::string dictionary_file;
+    std::optional<LZWDictionary> dictionary;
+    LZWOptions options;
+
+    /* Parse arguments */
+    try{
+        for(int i=1; i<argc; ++i){
+            const std::string arg = argv[i];
+            auto value = [&](){
+                if(i + 1 == argc) throw(std::invalid_argument(arg + " needs a value"));
+                return argv[++i];
+            };
+
+            if(arg == "-c" || arg == "-d" || arg == "-t") mode = arg[1];
+            else if(arg == "--train") mode = 'p';
+            else if(arg == "-o") output = value();
+            else if(arg == "-T") options.threads = number(arg, value());
+            else if(arg == "-W"){
+                const unsigned long width = number(arg, value());
+                if(width < static_cast<unsigned long>(options.min_width) || width > 20){
+                    throw(std::invalid_argument("-W must be from 9 to 20"));
+                }
+                options.max_width = static_cast<int>(width);
+                have_width = true;
+            }
+            else if(arg == "-B"){
+                options.block_size = number(arg, value());
+                if(options.block_size > UINT32_MAX) throw(std::invalid_argument("-B must be below 4 GiB"));
+                have_block_size = true;
+            }
+            else if(arg == "-S"){
+                options.sync_interval = number(arg, value());
+                if(options.sync_interval > UINT32_MAX) throw(std::invalid_argument("-S must be below 2^32"));
+            }
+            else if(arg == "-H") options.huffman = true;
+            else if(arg == "-e"){
+                const unsigned long effort = number(arg, value());
+                if(effort > 16) throw(std::invalid_argument("-e must be from 0 to 16"));
+                options.effort = static_cast<int>(effort);
+            }
+            else if(arg == "-D") dictionary_file = value();
+            else if(arg == "-f") force = true;
+            else if(arg == "-s" || arg == "--stats") stats = true;
+            else if(arg == "-h" || arg == "--help"){
+                std::cout << USAGE;
+                return 0;
+            }
+            else if(arg.size() > 1 && arg[0] == '-') throw(std::invalid_argument("unknown option " + arg));
+            else if(have_input) throw(std::invalid_argument("only one file can be given"));
+            else{
+                input = arg;
+                have_input = true;
+            }
+        }
+        if(options.sync_interval > 0 && !have_block_size) options.block_size = 0;
+        if(mode == 'p' && !have_width) options.max_width = 12;
+    }
+    catch(const std::exception& e){
+        std::cerr << "lzw: " << e.what() << "\nTry lzw --help\n";
+        return 2;
+    }
+
+    /* Load the trained dictionary, whose width the files take unless -W says otherwise */
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    if(!dictionary_file.empty() && mode != 'p'){
+        try{
+            if(!fs::is_regular_file(dictionary_file, ec)) throw(std::ifstream::failure("no such file"));
+            BinaryFIn in;
+            in.initialize(dictionary_file);
+            dictionary.emplace(LZWDictionary::read(in));
+        }
+        catch(const std::exception& e){
+            std::cerr << "lzw: " << dictionary_file << ": " << e.what() << "\n";
+            return 1;
+        }
+        options.dictionary = &*dictionary;
+        if(!have_width) options.max_width = dictionary->max_width();
+    }
+    try{
+        LZW::header(options);
+    }
+    catch(const std::exception& e){
+        std::cerr << "lzw: " << e.what() << "\nTry lzw --help\n";
+        return 2;
+    }
+
+    const bool from_stdin = input == "-";
+    if(mode == 't') output = "-";
+    if(output.empty()) output = from_stdin ? "-" : default_output(input, mode);
+    const bool to_stdout = output == "-";
+
+    /* Check the files before anything is created */
+    if(!from_stdin && !fs::is_regular_file(input, ec)){
+        std::cerr << "lzw: " << input << ": no such file\n";
+        return 1;
+    }
+    if(!to_stdout && fs::exists(output, ec)){
+        if(!from_stdin && fs::equivalent(input, output, ec)){
+            std::cerr << "lzw: " << output << ": output would overwrite the input\n";
+            return 1;
+        }
+        if(!force){
+            std::cerr << "lzw: " << output << ": already exists, use -f to overwrite\n";
+            return 1;
+        }
+    }
+
+    LZWStats result;
+    try{
+        NullBuffer discard;
+        std::ostream null_out(&discard);
+        std::ostream& out = mode == 't' ? null_out : std::cout;
+
+        if(mode == 'p'){
+            std::ifstream file;
+            if(!from_stdin){
+                file.open(input, std::ios::in|std::ios::binary);
+                if(!file.is_open()) throw(std::ifstream::failure("Cannot open " + input));
+            }
+            const std::vector<std::byte> sample = slurp(from_stdin ? std::cin : file);
+            const LZWDictionary trained = LZWDictionary::train(sample, options.max_width);
+            BinaryFOut dict_out;
+            if(to_stdout) dict_out.initialize(std::cout);
+            else dict_out.initialize(output);
+            if(!dict_out.is_open()) throw(std::ofstream::failure("Cannot create " + output));
+            trained.write(dict_out);
+            dict_out.close();
+            result.bytes_in = sample.size();
+        }
+        else if(!from_stdin){
+            LZW lzw(input, options);
+            if(mode == 'c') result = to_stdout ? lzw.compress(out) : lzw.compress(output);
+            else result = to_stdout ? lzw.expand(out) : lzw.expand(output);
+        }
+        else if(to_stdout){
+            if(mode == 'c') result = LZW::compress(std::cin, out, options);
+            else result = LZW::expand(std::cin, out, options.threads, options.dictionary);
+        }
+        else{
+            std::ofstream file(output, std::ios::out|std::ios::binary|std::ios::trunc);
+            if(!file.is_open()) throw(std::ofstream::failure("Cannot create " + output));
+            if(mode == 'c') result = LZW::compress(std::cin, file, options);
+            else result = LZW::expand(std::cin, file, options.threads, options.dictionary);
+            file.close();
+            if(!file) throw(std::ofstream::failure("Failed to write " + output));
+        }
+    }
+    catch(const std::exception& e){
+        std::cerr << "lzw: " << (from_stdin ? "stdin" : input) << ": " << e.what() << "\n";
+        if(!to_stdout && fs::is_regular_file(output, ec)) fs::remove(output, ec); // Never a device such as /dev/null
+        return 1;
+    }
+
+    if(stats) std::cerr << result.json() << std::endl;
+    return 0;
+}
@@ -0,0 +1,185 @@
+/**
+ * Implementation of arena-backed DLB Trie
+ *
+ * Same interface and semantics as DLB, but every node lives
+ * in one contiguous vector and links are 32-bit indices into it
+ * No per-node allocation and no reference counting while traversing
+ * The first level is a direct table indexed by character rather than
+ * a 256 node list, since every LZW lookup starts there
+ * Clearing the trie is O(1) and keeps the arena's storage for reuse
+*/
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "ArenaDLB.hh"
+
+ArenaDLB::ArenaDLB(){
+    /**
+     * Initialize an empty trie
+    */
+
+    clear();
+}
+
+ArenaDLB::ArenaDLB(std::size_t capacity){
+    /**
+     * Initialize an empty trie and
+     * reserve room for capacity nodes so building the trie
+     * does not reallocate
+     *
+     * @param capacity  Number of nodes to reserve
+    */
+
+    arena.reserve(capacity + 1);
+    clear();
+}
+
+void ArenaDLB::clear(){
+    /**
+     * Removes every string from the trie
+     * Nodes are trivially destructible, so this is O(1)
+     * (plus clearing the fixed 256 entry first level)
+     * and the arena's capacity is kept for reuse
+    */
+
+    arena.clear();
+    arena.push_back(DLB_Node{static_cast<char>(0), false, 0, NIL, NIL}); // Reserve NIL
+    std::fill(roots, roots + 256, NIL);
+}
+
+void ArenaDLB::restore(const ArenaDLB& primed){
+    /**
+     * Replaces every string with the strings of primed
+     * Only primed's nodes are copied, into the arena's storage,
+     * so with room for them nothing is allocated
+     *
+     * @param primed    Trie to copy the strings of
+    */
+
+    arena.assign(primed.arena.begin(), primed.arena.end());
+    std::copy(primed.roots, primed.roots + 256, roots);
+}
+
+std::size_t ArenaDLB::size(){
+    /**
+     * @returns Number of nodes in the trie
+    */
+
+    return arena.size() - 1;
+}
+
+void ArenaDLB::put(const std::string& s, int key){
+    /**
+     * Inserts given string into the trie and
+     * maps string to the given key
+     *
+     * @param s String to insert into trie
+     * @param key   Key to map string to in trie
+    */
+
+    if(s.empty()) return;
+
+    /* First character is found directly in the first level */
+    const unsigned char first = static_cast<unsigned char>(s[0]);
+    if(roots[first] == NIL) roots[first] = new_node(s[0]);
+    uint32_t parent = roots[first]; // Node whose down list holds the current character
+
+    /* Iterate over remaining characters, descending one level per character */
+    for(std::size_t i=1; i<s.length(); ++i){
+        const char ch = s[i];
+        uint32_t traverse = arena[parent].down;
+        uint32_t last = NIL; // Last node visited in the list, for appending
+
+        while(traverse != NIL && arena[traverse].c != ch){
+            last = traverse;
+            traverse = arena[traverse].right;
+        }
+
+        /* Case where node for character must be created */
+        if(traverse == NIL){
+            traverse = new_node(ch); // May reallocate, so index arena afterwards
+            if(last == NIL) arena[parent].down = traverse;
+            else arena[last].right = traverse;
+        }
+
+        parent = traverse;
+    }
+
+    arena[parent].key = key;
+    arena[parent].key_valid = true;
+}
+
+void ArenaDLB::put(char c, int key){
+    /**
+     * Overloaded member for inserting a single
+     * char into the trie with a given key
+     *
+     * @param c char to insert into trie
+     * @param key   Key (int) to map char to in trie
+    */
+
+    std::string s(1, c);
+    put(s, key);
+}
+
+std::string ArenaDLB::longest_prefix_of(const std::string& s){
+    /**
+     * Given a string, returns longest string in trie
+     * that is a prefix of the given string
+     *
+     * @param s String to prefix match to
+     * @returns Longest string in trie that is a prefix of s
+    */
+
+    if(s.empty()) return s;
+
+    std::size_t length = 0; // Length of longest valid key seen so far
+    uint32_t traverse = roots[static_cast<unsigned char>(s[0])];
+    if(traverse == NIL) return std::string();
+    if(arena[traverse].key_valid) length = 1;
+    traverse = arena[traverse].down;
+
+    /* Iterate over remaining characters one by one, descending one level per match */
+    for(std::size_t i=1; i<s.length(); ++i){
+        const char ch = s[i];
+        while(traverse != NIL && arena[traverse].c != ch) traverse = arena[traverse].right;
+        /* Check if traverse is at proper character */
+        if(traverse == NIL) break;
+
+        if(arena[traverse].key_valid) length = i + 1;
+        traverse = arena[traverse].down;
+    }
+
+    return s.substr(0, length);
+}
+
+int ArenaDLB::get(const std::string& s){
+    /**
+     * Fetches key of given string in trie
+     * Throws invalid_argument exception if s not
+     * in trie
+     *
+     * @param s String to retrieve key for
+     * @returns Key of given string
+     * @throws invalid_argument exception if s not in trie
+    */
+
+    if(s.empty()) throw std::invalid_argument("String not in trie");
+
+    uint32_t parent = roots[static_cast<unsigned char>(s[0])]; // Node holding the last matched character
+    if(parent == NIL) throw std::invalid_argument("String not in trie");
+
+    /* Iterate over the remaining characters one by one */
+    for(std::size_t i=1; i<s.length(); ++i){
+        const char ch = s[i];
+        uint32_t traverse = arena[parent].down;
+        while(traverse != NIL && arena[traverse].c != ch) traverse = arena[traverse].right;
+        /* Check if traverse is at proper character */
+        if(traverse == NIL) throw std::invalid_argument("String not in trie");
+        parent = traverse;
+    }
+
+    if(!arena[parent].key_valid) throw std::invalid_argument("String not in trie");
+    return arena[parent].key;
+}
@@ -0,0 +1,136 @@
+#ifndef ARENA_DLB_COMP
+#define ARENA_DLB_COMP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+#include "LZWStats.hh"
+
+class ArenaDLB{
+    private:
+        struct DLB_Node{
+            /**
+             * Private struct for the nodes in each
+             * linked list in the DLB
+             * Links are indices into the arena instead of pointers
+            */
+
+            char c; // Character of node
+            bool key_valid; // Flag to check if key is valid (is a valid inserted string)
+            int key; // Key of string, if node is last representation
+            uint32_t right; // Index of right list node (NIL if none)
+            uint32_t down; // Index of first node in down list (NIL if none)
+        };
+        std::vector<DLB_Node> arena; // Contiguous storage for every node
+        uint32_t roots[256]; // First level of the trie, indexed directly by character
+        uint64_t visits = 0; // Nodes looked at by child(), counted only if LZW_STATS_ENABLED
+        uint32_t new_node(char c); // Append a node to the arena and return its index
+
+    public:
+        static constexpr uint32_t NIL = 0; // Index 0 is reserved, no node is stored there
+        ArenaDLB();
+        ArenaDLB(std::size_t capacity); // Reserve room for capacity nodes up front
+        void put(const std::string& s, int key); // Put s into trie with key
+        void put(char c, int key); // Put c into trie with key
+        std::string longest_prefix_of(const std::string& s); // Prefix match with string s
+        int get(const std::string& s); // Get key for string s
+        void clear(); // Remove every string, keeping the arena's storage
+        void restore(const ArenaDLB& primed); // Hold exactly primed's strings, reusing the arena's storage
+        std::size_t size(); // Number of nodes in the trie
+
+        /* Node-level access for walking the trie one character at a time */
+        uint32_t child(uint32_t node, char c); // Child of node for c (NIL node is the first level)
+        uint32_t add_child(uint32_t node, char c, int key); // Insert c below node with key
+        int key_of(uint32_t node); // Key stored at node
+        uint64_t visited(); // Nodes looked at by child() so far, with LZW_STATS
+};
+
+/* Node-level members are inline so encoders walking the trie inline them */
+
+inline uint32_t ArenaDLB::new_node(char c){
+    /**
+     * Private member that appends a node with no key
+     * and no links to the arena
+     *
+     * @param c Character of the new node
+     * @returns Index of the new node
+    */
+
+    arena.push_back(DLB_Node{c, false, 0, NIL, NIL});
+    return static_cast<uint32_t>(arena.size() - 1);
+}
+
+inline uint32_t ArenaDLB::child(uint32_t node, char c){
+    /**
+     * Finds the node for character c directly below the given node
+     * Lets a caller walk the trie one character at a time
+     * without building strings
+     *
+     * @param node  Index of the node to descend from, NIL for the first level
+     * @param c Character to look for
+     * @returns Index of the child node, NIL if there is none
+    */
+
+    if constexpr(LZW_STATS_ENABLED) visits++;
+    if(node == NIL) return roots[static_cast<unsigned char>(c)];
+
+    uint32_t traverse = arena[node].down;
+    while(traverse != NIL && arena[traverse].c != c){
+        traverse = arena[traverse].right;
+        if constexpr(LZW_STATS_ENABLED) visits++;
+    }
+    return traverse;
+}
+
+inline uint32_t ArenaDLB::add_child(uint32_t node, char c, int key){
+    /**
+     * Inserts character c directly below the given node and
+     * maps the resulting string to key
+     * Assumes the child does not already exist (child() returned NIL),
+     * so the new node is linked at the front of the down list
+     *
+     * @param node  Index of the node to insert below, NIL for the first level
+     * @param c Character to insert
+     * @param key   Key to map the new string to
+     * @returns Index of the new node
+    */
+
+    uint32_t added = new_node(c);
+    arena[added].key = key;
+    arena[added].key_valid = true;
+
+    if(node == NIL){
+        roots[static_cast<unsigned char>(c)] = added;
+    }
+    else{
+        arena[added].right = arena[node].down;
+        arena[node].down = added;
+    }
+
+    return added;
+}
+
+inline int ArenaDLB::key_of(uint32_t node){
+    /**
+     * @param node  Index of a node returned by child() or add_child()
+     * @returns Key stored at the node
+     * @throws invalid_argument if no string ends at the node
+    */
+
+    if(node == NIL || !arena[node].key_valid) throw std::invalid_argument("No key at node");
+    return arena[node].key;
+}
+
+inline uint64_t ArenaDLB::visited(){
+    /**
+     * @returns Number of nodes child() has looked at, across clears;
+     *  always 0 unless LZW_STATS_ENABLED
+    */
+
+    return visits;
+}
+
+#endif
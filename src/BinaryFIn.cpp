@@ -1,82 +1,374 @@
 /**
  * Implementation of binary file I/O
- * Able to read next n bits of a file where n is some multiple of 8 (up to 64)
+ * Able to read next r bits of a file for any r up to 32
  * Implementation based on BinaryStdIn.java
  * https://introcs.cs.princeton.edu/java/stdlib/BinaryStdIn.java.html
- * 
+ *
+ * The file is read a block (64 KiB by default) at a time, and bits
+ * are served from a 64-bit accumulator that is refilled from the
+ * block a word at a time
+ * Bits are kept left-aligned in the accumulator, so any width is
+ * extracted with one shift and refilling from the block is a single
+ * unaligned 8-byte load with no per-byte loop or branches
+ * Can also read from a span of memory, or a read-only mapping
+ * of the file, served in place with no copy, or from a caller's
+ * stream such as std::cin
+ *
 */
 
 #include "BinaryFIn.hh"
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include <bit>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define BINARY_F_IN_MMAP
+#endif
+
+static inline uint64_t load_be64(const unsigned char* p){
+    /**
+     * Loads 8 bytes as a big-endian 64-bit word
+     *
+     * @param p Pointer to at least 8 readable bytes
+     * @returns The bytes as a word, first byte most significant
+    */
+
+    uint64_t w;
+    std::memcpy(&w, p, sizeof w);
+    if constexpr(std::endian::native == std::endian::little) w = __builtin_bswap64(w);
+    return w;
+}
+
+BinaryFIn::BinaryFIn() : BinaryFIn(DEFAULT_BLOCK_SIZE){
+}
 
+BinaryFIn::BinaryFIn(std::size_t block_size){
+    /**
+     * Constructor with the number of bytes to read from
+     * the file at once
+     *
+     * @param block_size    Size of the block buffer in bytes (at least 16)
+     * @throws invalid_argument if block_size is less than 16
+    */
+
+    if(block_size < 16){
+        throw(std::invalid_argument("Block size must be at least 16 bytes"));
+    }
 
-BinaryFIn::BinaryFIn(){
+    block.resize(block_size);
+    source = &file;
+    data = block.data();
+    pos = 0;
+    end = 0;
+    length = 0;
+    in_memory = false;
+    mapping = nullptr;
+    mapped_length = 0;
     n = -1;
-    buffer = -1;
+    buffer = 0;
     at_eof = false;
     is_initialized = false;
 }
 
+BinaryFIn::~BinaryFIn(){
+    /**
+     * Closes the file and releases any mapping
+    */
+
+    close();
+}
+
 void BinaryFIn::initialize(std::string file_name){
     /**
      * Private member for initializing the object
      * Opens the given file in ios::binary mode
      * Sets buffer and number of bits to 0
      * Marks as initialized
-     * 
+     *
      * @param file_name Name of file to open
     */
 
-    file.open(file_name, std::ios::in|std::ios::binary);
+    file.open(file_name, std::ios::in|std::ios::binary|std::ios::ate);
 
     // Ensure that file was successfully opened
     if(!file.is_open()){
         std::cout << "Error opening file. Does it exist?" << std::endl;
         n = -1;
-        buffer = -1;
+        buffer = 0;
         at_eof = false;
         is_initialized = false;
         return;
     }
 
+    length = static_cast<std::size_t>(file.tellg());
+    file.seekg(0);
+
+    source = &file;
+    data = block.data();
+    in_memory = false;
+    pos = 0;
+    end = 0;
+    n = 0;
+    buffer = 0;
+    is_initialized = true;
+    at_eof = false;
+}
+
+void BinaryFIn::initialize(std::span<const unsigned char> bytes){
+    /**
+     * Initializer for reading from memory instead of a file
+     * Bytes are read in place, so they must outlive this object
+     * or the next initialize
+     *
+     * @param bytes Memory to read from
+    */
+
+    data = bytes.data();
+    in_memory = true;
+    length = bytes.size();
+    pos = 0;
+    end = bytes.size();
+    n = 0;
+    buffer = 0;
+    is_initialized = true;
+    at_eof = true; // Nothing to read beyond the span
+}
+
+void BinaryFIn::initialize(std::istream& stream){
+    /**
+     * Initializer for reading a caller's stream, such as std::cin
+     * or a pipe, a block at a time instead of a file
+     * The stream is only read forward, so its size is not known
+     * in advance and it cannot be seeked
+     *
+     * @param stream    Stream to read, must outlive this object
+     *  or the next close
+    */
+
+    close();
+    source = &stream;
+    data = block.data();
+    in_memory = false;
+    length = 0;
+    pos = 0;
+    end = 0;
     n = 0;
     buffer = 0;
     is_initialized = true;
     at_eof = false;
 }
 
+bool BinaryFIn::initialize_mapped(std::string file_name){
+    /**
+     * Initializer for reading a memory mapping of a file
+     * The whole file is mapped read-only and read in place like
+     * memory, with the kernel told it will be read sequentially,
+     * so pages are read ahead and dropped behind and nothing is copied
+     * Only regular files on POSIX systems can be mapped
+     *
+     * @param file_name Name of file to map
+     * @returns false, leaving the object uninitialized, if the file
+     *  cannot be mapped; initialize(file_name) can then read it instead
+    */
+
+    close();
+
+#if defined(BINARY_F_IN_MMAP)
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)){
+        ::close(fd);
+        return false;
+    }
+
+    const std::size_t size = static_cast<std::size_t>(info.st_size);
+    if(size > 0){
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p == MAP_FAILED){
+            ::close(fd);
+            return false;
+        }
+        madvise(p, size, MADV_SEQUENTIAL);
+        mapping = p;
+        mapped_length = size;
+    }
+    ::close(fd); // The mapping stays valid without the descriptor
+
+    initialize(std::span<const unsigned char>(static_cast<const unsigned char*>(mapping), size));
+    return true;
+#else
+    (void)file_name;
+    return false;
+#endif
+}
+
+std::span<const unsigned char> BinaryFIn::bytes(){
+    /**
+     * @returns The whole input, in place, when reading memory or
+     *  a mapping; an empty span when reading a file in blocks
+    */
+
+    if(!is_initialized || !in_memory) return std::span<const unsigned char>();
+    return std::span<const unsigned char>(data, length);
+}
+
+void BinaryFIn::release(std::span<const unsigned char> done){
+    /**
+     * Tells the kernel that part of the mapping has been read for the
+     * last time, so its pages stop counting towards resident memory
+     * They are read back from the file if touched again, so this is
+     * only an optimisation and never changes what is read
+     * Does nothing unless done lies within the mapping
+     *
+     * @param done  Part of bytes() that will not be read again
+    */
+
+#if defined(BINARY_F_IN_MMAP)
+    if(mapping == nullptr || done.empty()) return;
+
+    const uintptr_t lo = reinterpret_cast<uintptr_t>(mapping);
+    const uintptr_t first = reinterpret_cast<uintptr_t>(done.data());
+    const uintptr_t last = first + done.size();
+    if(first < lo || last > lo + mapped_length) return;
+
+    /* Only whole pages inside done, pages it shares may still be read */
+    const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t from = (first + page - 1) & ~(page - 1);
+    const uintptr_t to = last == lo + mapped_length ? last : last & ~(page - 1);
+    if(from < to) madvise(reinterpret_cast<void*>(from), to - from, MADV_DONTNEED);
+#else
+    (void)done;
+#endif
+}
+
+void BinaryFIn::seek(std::size_t offset){
+    /**
+     * Continues reading at the given byte offset
+     * Any bits left in the accumulator are discarded
+     *
+     * @param offset    Byte offset from the start of the input
+     * @throws invalid_argument if offset is past the end of the input,
+     *  or the input is a caller's stream
+    */
+
+    if(!is_initialized) return;
+    if(!in_memory && source != &file){
+        throw(std::invalid_argument("Cannot seek in a stream"));
+    }
+    if(offset > length){
+        throw(std::invalid_argument("Seek past end of input"));
+    }
+
+    n = 0;
+    buffer = 0;
+    if(in_memory){
+        pos = offset;
+        return;
+    }
+
+    file.clear();
+    file.seekg(offset);
+    pos = 0;
+    end = 0;
+    at_eof = false;
+}
+
+std::size_t BinaryFIn::size(){
+    /**
+     * @returns Total size of the input in bytes,
+     *  0 for a caller's stream, whose size is not known
+    */
+
+    return length;
+}
+
+void BinaryFIn::fill_block(){
+    /**
+     * Private member for reading the next block of
+     * the file into the block buffer
+     * Unread bytes are moved to the front first so word
+     * loads never straddle two blocks
+     * Sets EOF flag once the file has no more data
+    */
+
+    if(at_eof || !is_initialized) return;
+
+    std::size_t left = end - pos;
+    std::memmove(block.data(), block.data() + pos, left);
+    pos = 0;
+    end = left;
+
+    source->read(reinterpret_cast<char *>(block.data() + left), block.size() - left);
+    std::size_t got = static_cast<std::size_t>(source->gcount());
+    end += got;
+    if(got < block.size() - left) at_eof = true;
+}
+
 void BinaryFIn::fill_buffer(){
     /**
-     * Private member for filling the buffer with
-     * the next byte from the file
-     * Assumes will NOT be called when already at EOF
+     * Private member for topping up the bit accumulator
+     * until it holds at least 56 bits or the file runs out
+     *
+     * Loads the next 8 bytes of the block as one word and keeps
+     * as many whole bytes as fit; the bits past the n valid ones
+     * are the correct next bits of the file, so reloading them
+     * later ORs in identical values
+     * Falls back to a byte at a time only near the end of the file
     */
 
-    char input;
-    file.read(reinterpret_cast<char *>(&input), sizeof input);
+    if(end - pos < 8 && !at_eof) fill_block();
 
-    buffer = static_cast<char>(input);
-    n = 8;
-    if(file.eof()) at_eof = true;
+    if(end - pos >= 8){
+        buffer |= load_be64(data + pos) >> n;
+        pos += (63 - n) >> 3;
+        n |= 56;
+        return;
+    }
+
+    while(n <= 56 && pos < end){
+        buffer |= static_cast<uint64_t>(data[pos++]) << (56 - n);
+        n += 8;
+    }
 }
 
 void BinaryFIn::close(){
     /**
-     * Closes the file ifsream
+     * Closes the file ifsream, or unmaps the file
+     * A caller's stream is left open
     */
+
+#if defined(BINARY_F_IN_MMAP)
+    if(mapping != nullptr) munmap(mapping, mapped_length);
+#endif
+    mapping = nullptr;
+    mapped_length = 0;
     if(!is_initialized) return;
 
     try{
-        file.close();
+        if(!in_memory && source == &file) file.close();
+        source = &file;
         is_initialized = false;
+        data = block.data();
+        in_memory = false;
+        length = 0;
+        pos = 0;
+        end = 0;
         n = -1;
-        buffer = -1;
+        buffer = 0;
         at_eof = false;
     }
     catch(const std::ifstream::failure& e){
-       std::cout << "Failed to close file\n" << e.what() << std::endl; 
+       std::cout << "Failed to close file\n" << e.what() << std::endl;
     }
 }
 
@@ -84,140 +376,72 @@ char BinaryFIn::read_bit(){
     /**
      * Gets the next bit of data from file and returns as
      * 8-bit char
-     * 
+     *
      * @returns Next bit of data from file as char
      * @throws ifstream::failure if at end of file
     */
 
-    if(at_eof){
-        throw(std::ifstream::failure("At end of file"));
-    }
-
-    // If buffer empty, fill it
-    if(n == 0) fill_buffer();
-
-    --n;
-    char c = (buffer >> n) & 0x1;
-    if(n == 0){
-        n = 8;
-        if(!at_eof) fill_buffer();
-    }
-    return c;
+    return static_cast<char>(read_r(1));
 }
 
 char BinaryFIn::read_char(){
     /**
      * Gets the next 8 bits of data from file and returns as
      * an 8-bit char
-     * 
+     *
      * @returns Next 8 bts of data from file as char
-     * @throws  ifstream::failure if at end of file (EOF set true)  
+     * @throws  ifstream::failure if at end of file (EOF set true)
     */
-   
-    if(at_eof){
-        throw(std::ifstream::failure("At end of file"));
-    }
-
-    unsigned char c = 0; // need unsigned type for arithmetic right shift
 
-    // If buffer empty, fill it
-    if(n == 0) fill_buffer();
-
-    // Check case for perfect bit-alignment
-    if(n == 8){
-        c = buffer;
-        if(!at_eof) fill_buffer();
-        return c;
-    }
-
-    // Need to perform bit-alignment for remaining buffer
-    int offset = 8-n; // offset of remaining buffer from 8 bits 
-    c = buffer;
-    c <<= offset;
-    fill_buffer();
-    n = 8-offset; // set n to old value
-    c |= buffer >> n; // only want upper offset bits of buffer
-
-    return c;
+    return static_cast<char>(read_r(8));
 }
 
 short BinaryFIn::read_short(){
     /**
      * Gets the next 16 bits of data from file and returns as
      * a 16-bit short
-     * 
+     *
      * @returns Next 16 bits of data from file as short
      * @throws  ifstream::failure if at end of file
     */
 
-    if(at_eof){
-        throw(std::ifstream::failure("At end of file"));
-    }
-
-    short c = 0;
-
-    // Just need to read 2 chars into the short
-    for(int i=0; i<2; i++){
-        c <<= 8;
-        c |= read_char();
-    }
-
-    return c;
+    return static_cast<short>(read_r(16));
 }
 
 int BinaryFIn::read_int(){
     /**
      * Gets the next 32 bits of data from file as
      * a 32-bit int
-     * 
+     *
      * @returns Next 32 bits of data from file as int
      * @throws ifstream::failure if at end of file
     */
 
-    if(at_eof){
-        throw(std::ifstream::failure("At end of file"));
-    }
-
-    int c = 0;
-
-    // Need to read 2 shorts into the int
-    for(int i=0; i<2; i++){
-        c <<= 16;
-        c |= read_short();
-    }
-
-    return c;
+    return read_r(32);
 }
 
 long BinaryFIn::read_long(){
     /**
      * Gets the next 64 bits of data from file as
      * a 64-bit long
-     * 
+     *
      * @returns Next 64 bits of data from file as long
-     * @throws  ifstream::failure if at end of file 
+     * @throws  ifstream::failure if at end of file
     */
 
-    if(at_eof){
-        throw(std::ifstream::failure("At end of file"));
-    }
-
-    long c = 0;
-
     // Need to read 2 ints into the long
-    for(int i=0; i<2; i++){
-        c <<= 32;
-        c |= read_int();
-    }
+    unsigned long c = static_cast<unsigned int>(read_r(32));
+    c <<= 32;
+    c |= static_cast<unsigned int>(read_r(32));
 
-    return c;
+    return static_cast<long>(c);
 }
 
 int BinaryFIn::read_r(const int r){
     /**
      * Gets the next r bits of data from file as
      * 32-bit int
-     * 
+     *
      * @param r     int between 1 and 32 to specify number of bits to get
      * @returns     Next r bits of data from file as int
      * @throws      ifstream::failure if at end of file
@@ -226,61 +450,186 @@ int BinaryFIn::read_r(const int r){
 
     if(!(r>=1 && r<=32)){
         throw(std::invalid_argument("Number of bits requested must be between 1 and 32"));
-    } 
+    }
+
+    if(n < r){
+        fill_buffer();
+        if(n < r) throw(std::ifstream::failure("At end of file"));
+    }
+
+    int c = static_cast<int>(buffer >> (64 - r));
+    buffer <<= r;
+    n -= r;
+    return c;
+}
+
+std::size_t BinaryFIn::read_r(std::span<int> codes, const int r){
+    /**
+     * Gets up to codes.size() codewords of r bits each
+     * One refill serves as many whole codewords as fit in 56 bits,
+     * so there is no EOF check or call per codeword
+     * Each LZW codeword width has its own loop with r folded in
+     *
+     * @param codes Span to fill with codewords
+     * @param r     int between 1 and 32 to specify bits per codeword
+     * @returns     Number of codewords read, less than codes.size() only at end of file
+     * @throws      invalid_argument if r not between 1 and 32
+    */
+
+    if(!(r>=1 && r<=32)){
+        throw(std::invalid_argument("Number of bits requested must be between 1 and 32"));
+    }
 
-    // Handle optimized cases
     switch(r){
-        case 8:
-            return read_char();
-            break;
-        case 16:
-            return read_short();
-            break;
-        case 32:
-            return read_int();
-            break;
+        case 9: return read_codes<9>(codes, r);
+        case 10: return read_codes<10>(codes, r);
+        case 11: return read_codes<11>(codes, r);
+        case 12: return read_codes<12>(codes, r);
+        case 13: return read_codes<13>(codes, r);
+        case 14: return read_codes<14>(codes, r);
+        case 15: return read_codes<15>(codes, r);
+        case 16: return read_codes<16>(codes, r);
+        case 17: return read_codes<17>(codes, r);
+        case 18: return read_codes<18>(codes, r);
+        case 19: return read_codes<19>(codes, r);
+        case 20: return read_codes<20>(codes, r);
+        default: return read_codes<0>(codes, r);
     }
+}
 
-    // Read bits in individually
-    int c = 0;
-    for(int i=0; i<r; i++){
-        c <<= 1;
-        c |= read_bit();
+template<int R>
+std::size_t BinaryFIn::read_codes(std::span<int> codes, const int width){
+    /**
+     * Private member for read_r() of codewords
+     *
+     * @param codes Span to fill with codewords
+     * @param width Bits per codeword, equal to R unless R is 0
+     * @returns     Number of codewords read, less than codes.size() only at end of file
+    */
+
+    const int r = R > 0 ? R : width;
+    const std::size_t per = 56 / r; // Codewords per refill
+    std::size_t i = 0;
+
+    // Refill once, then extract with no further checks
+    while(codes.size() - i >= per){
+        fill_buffer();
+        if(n < 56) break; // Near end of file
+        for(std::size_t k=0; k<per; ++k){
+            codes[i++] = static_cast<int>(buffer >> (64 - r));
+            buffer <<= r;
+        }
+        n -= per * r;
     }
 
-    return c; 
+    // Careful tail, one codeword at a time
+    while(i < codes.size()){
+        if(n < r) fill_buffer();
+        if(n < r) break;
+        codes[i++] = static_cast<int>(buffer >> (64 - r));
+        buffer <<= r;
+        n -= r;
+    }
+
+    return i;
 }
 
 std::string BinaryFIn::read_string(){
     /**
      * Gets the remaining bytes of data from file
      * as a string
-     * 
+     *
      * @returns Remaining data of file as string
-     * @throws  ifstream::failure if at end of file 
+     * @throws  ifstream::failure if at end of file
     */
 
-    if(at_eof){
+    if(get_eof()){
         throw(std::ifstream::failure("At end of file"));
     }
 
     std::string c;
-    // Iterate over every character in file and build string to return
-    while(!at_eof){
-        char next = read_char();
-        c.append(1,next);
+    std::vector<char> chunk(block.size());
+    std::size_t got;
+    // Append the file a block at a time
+    while((got = read_bytes(chunk.data(), chunk.size())) > 0){
+        c.append(chunk.data(), got);
     }
 
     return c;
 }
 
+std::size_t BinaryFIn::read_bytes(char* s, std::size_t count){
+    /**
+     * Gets up to the next count bytes of data from file
+     * Lets callers work through a file in bounded windows
+     * instead of holding all of it
+     * When byte-aligned, bytes are copied straight out of the block
+     *
+     * @param s     Buffer with room for at least count bytes
+     * @param count Maximum number of bytes to read
+     * @returns     Number of bytes read, 0 once at end of file
+    */
+
+    if(!is_initialized) return 0;
+
+    std::size_t i = 0;
+
+    // Not byte-aligned, every byte straddles two bytes of the file
+    // Stops before any trailing padding of less than a byte
+    if(n % 8 != 0){
+        while(i < count){
+            if(n < 8) fill_buffer();
+            if(n < 8) break;
+            s[i++] = static_cast<char>(buffer >> 56);
+            buffer <<= 8;
+            n -= 8;
+        }
+        return i;
+    }
+
+    // Drain whole bytes already in the accumulator
+    while(i < count && n > 0){
+        s[i++] = static_cast<char>(buffer >> 56);
+        buffer <<= 8;
+        n -= 8;
+    }
+    if(n > 0) return i;
+    buffer = 0; // Bytes below are about to be consumed directly from the block
+
+    // Copy the rest directly from the block, reading new blocks as needed
+    while(i < count){
+        if(pos == end){
+            fill_block();
+            if(pos == end) break;
+        }
+        std::size_t take = std::min(count - i, end - pos);
+        std::memcpy(s + i, data + pos, take);
+        pos += take;
+        i += take;
+    }
+
+    return i;
+}
+
+bool BinaryFIn::is_open(){
+    /**
+     * @returns True if initialized and not closed, false
+     *  if the file could not be opened
+    */
+
+    return is_initialized;
+}
+
 bool BinaryFIn::get_eof(){
     /**
      * Public getter method to return end-of-file
      * (EOF) flag status
-     * 
-     * @returns EOF flag
+     *
+     * @returns True if no bits remain to be read
     */
 
-    return at_eof;
-}
\ No newline at end of file
+    if(n > 0 || pos < end) return false;
+    if(!at_eof) fill_block();
+
+    return pos == end;
+}
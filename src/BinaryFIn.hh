@@ -4,29 +4,89 @@
 #include<iostream>
 #include<fstream>
 #include<string>
+#include<vector>
+#include<cstddef>
+#include<cstdint>
+#include<span>
 
 class BinaryFIn{
     private:
         std::ifstream file; // file input stream
-        unsigned char buffer{}; // unsigned buffer to maintain
+        std::istream* source; // stream blocks are read from: file, or a caller's stream
+        std::vector<unsigned char> block; // block of bytes read from file at once
+        const unsigned char* data; // bytes being read: the block, or caller's memory
+        std::size_t pos; // index of next unread byte in data
+        std::size_t end; // number of valid bytes in data
+        std::size_t length; // total size of the input in bytes
+        bool in_memory; // flag set when reading caller's memory or a mapping instead of a file
+        void* mapping; // start of the file mapped by initialize_mapped (nullptr if none)
+        std::size_t mapped_length; // number of bytes mapped
+        uint64_t buffer; // bit accumulator, next n bits are its high bits (MSB first)
         int n; // number of bits remaining in buffer
         bool is_initialized; // flag to keep track of initialization
-        bool at_eof; // flag to check if at eof
+        bool at_eof; // flag set once the file has no more blocks
+        void fill_block();
         void fill_buffer();
         char read_bit();
+        template<int R>
+        std::size_t read_codes(std::span<int> codes, const int width);
 
     public:
+       static const std::size_t DEFAULT_BLOCK_SIZE = 1 << 16; // 64 KiB
        BinaryFIn();
+       BinaryFIn(std::size_t block_size); // Read the file block_size bytes at a time
+       ~BinaryFIn();
        void initialize(std::string file_name);
+       void initialize(std::span<const unsigned char> bytes); // read from memory instead of a file
+       void initialize(std::istream& stream); // read a caller's stream (such as std::cin) in order
+       bool initialize_mapped(std::string file_name); // read a memory mapping of the file
+       std::span<const unsigned char> bytes(); // whole input, when it is in memory or mapped
+       void release(std::span<const unsigned char> done); // drop mapped pages that will not be read again
+       void seek(std::size_t offset); // continue reading at byte offset
+       std::size_t size(); // total size of the input in bytes, 0 for a stream
        void close();
        bool get_eof();
+       bool is_open(); // whether the input was initialized successfully
        char read_char();
        short read_short();
        int read_int();
        long read_long();
-       int read_r(const int r); 
+       int read_r(const int r);
+       std::size_t read_r(std::span<int> codes, const int r); // read up to codes.size() r-bit codewords
+       uint32_t peek_r(const int r); // look at the next r bits without consuming them
+       void skip_r(const int r); // consume r bits already looked at
        std::string read_string();
-         
+       std::size_t read_bytes(char* s, std::size_t count);
+
 };
 
-#endif
\ No newline at end of file
+/* Looking ahead is inline so prefix code decoders inline it */
+
+inline uint32_t BinaryFIn::peek_r(const int r){
+    /**
+     * Gets the next r bits of data without consuming them,
+     * for decoders that look up a prefix code in a table
+     * and then take only the bits of the code they found
+     *
+     * @param r     int between 1 and 32 to specify number of bits to look at
+     * @returns     Next r bits of data, padded with 0s past the end of file
+    */
+
+    if(n < r) fill_buffer();
+    return static_cast<uint32_t>(buffer >> (64 - r));
+}
+
+inline void BinaryFIn::skip_r(const int r){
+    /**
+     * Consumes the next r bits, after peek_r() has looked at them
+     *
+     * @param r     int between 0 and 32 to specify number of bits to consume
+     * @throws      ifstream::failure if fewer than r bits are left
+    */
+
+    if(n < r) throw(std::ifstream::failure("At end of file"));
+    buffer <<= r;
+    n -= r;
+}
+
+#endif
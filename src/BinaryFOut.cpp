@@ -1,22 +1,147 @@
 /**
  * Implementtaion of binary file output
- * Maintain a buffer of 8 bits to output to a binary file
+ * Maintain a 64-bit accumulator of bits to output to a binary file
  * Implementation based on BinarySTDOut.java
  * https://introcs.cs.princeton.edu/java/stdlib/BinaryStdOut.java.html
- * 
+ *
+ * Bits are packed left-aligned into the accumulator, which is stored
+ * into a block buffer (64 KiB by default) as one 8-byte word after
+ * every write, advancing by however many whole bytes it held
+ * Any width is inserted with a few shifts and no per-bit loop
+ * The block is written to the file only when full or flushed
+ * Can also append to a vector in memory, fill a caller's
+ * fixed buffer or write to a caller's stream instead of a file
+ * File output can be asynchronous: full blocks are handed to a
+ * background thread that writes them while the caller fills the
+ * next one, so slow storage stalls the caller only once every
+ * block is waiting to be written
+ *
 */
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
+#include <exception>
+#include <cstring>
+#include <algorithm>
+#include <bit>
+#include <utility>
 #include "BinaryFOut.hh"
 
-BinaryFOut::BinaryFOut(){
+static inline void store_be64(unsigned char* p, uint64_t w){
     /**
-     * Default constructor to initialize all values
-     * and set "initialized" flag to false
+     * Stores a 64-bit word as 8 big-endian bytes
+     *
+     * @param p Pointer to at least 8 writable bytes
+     * @param w Word to store, most significant byte first
     */
-    buffer = -1;
+
+    if constexpr(std::endian::native == std::endian::little) w = __builtin_bswap64(w);
+    std::memcpy(p, &w, sizeof w);
+}
+
+template<class Byte>
+static void append_vector(void* sink, const unsigned char* bytes, std::size_t count, std::size_t){
+    /**
+     * Appends bytes to a vector sink
+     *
+     * @param sink  std::vector<Byte> to append to
+     * @param bytes Bytes to append
+     * @param count Number of bytes
+    */
+
+    auto* v = static_cast<std::vector<Byte>*>(sink);
+    const Byte* b = reinterpret_cast<const Byte*>(bytes);
+    v->insert(v->end(), b, b + count);
+}
+
+static void append_region(void* sink, const unsigned char* bytes, std::size_t count, std::size_t offset){
+    /**
+     * Copies bytes into a fixed buffer sink
+     *
+     * @param sink  std::span<unsigned char> to copy into
+     * @param bytes Bytes to copy
+     * @param count Number of bytes
+     * @param offset    Number of bytes already copied into the buffer
+     * @throws invalid_argument if the buffer has no room for count more bytes
+    */
+
+    auto* region = static_cast<std::span<unsigned char>*>(sink);
+    if(count > region->size() - offset){
+        throw(std::invalid_argument("Output buffer is too small"));
+    }
+    std::memcpy(region->data() + offset, bytes, count);
+}
+
+static void append_stream(void* sink, const unsigned char* bytes, std::size_t count, std::size_t){
+    /**
+     * Writes bytes to a stream sink
+     *
+     * @param sink  std::ostream to write to
+     * @param bytes Bytes to write
+     * @param count Number of bytes
+     * @throws ofstream::failure if the stream fails, so a closed pipe
+     *  or full disk is not mistaken for success
+    */
+
+    auto* stream = static_cast<std::ostream*>(sink);
+    stream->write(reinterpret_cast<const char*>(bytes), count);
+    if(!*stream) throw(std::ofstream::failure("Failed to write output"));
+}
+
+static void flush_stream(void* sink){
+    /**
+     * Flushes a stream sink
+     *
+     * @param sink  std::ostream to flush
+     * @throws ofstream::failure if the stream fails
+    */
+
+    auto* stream = static_cast<std::ostream*>(sink);
+    stream->flush();
+    if(!*stream) throw(std::ofstream::failure("Failed to write output"));
+}
+
+BinaryFOut::BinaryFOut() : BinaryFOut(DEFAULT_BLOCK_SIZE){
+}
+
+BinaryFOut::BinaryFOut(std::size_t block_size){
+    /**
+     * Constructor with the number of bytes to
+     * collect before writing to the file
+     * Initializes all values and sets "initialized" flag to false
+     *
+     * @param block_size    Size of the block buffer in bytes (at least 16)
+     * @throws invalid_argument if block_size is less than 16
+    */
+
+    if(block_size < 16){
+        throw(std::invalid_argument("Block size must be at least 16 bytes"));
+    }
+
+    block.resize(block_size);
+    pos = 0;
+    written = 0;
+    sink = nullptr;
+    append = nullptr;
+    buffer = 0;
     n = -1;
     is_initialzied = false;
+    busy = false;
+    stopping = false;
+    failed = false;
+}
+
+BinaryFOut::~BinaryFOut(){
+    /**
+     * Writes out anything still buffered
+     * Errors are dropped, call close() to see them
+    */
+
+    try{
+        close();
+    }
+    catch(const std::exception&){
+    }
 }
 
 void BinaryFOut::initialize(std::string file_name){
@@ -24,7 +149,7 @@ void BinaryFOut::initialize(std::string file_name){
      * Initializer for object
      * Opens file file_name in ios::out mode
      * Initializes members
-     * 
+     *
      * @param file_name Name of file to output to
     */
 
@@ -34,6 +159,150 @@ void BinaryFOut::initialize(std::string file_name){
         std::cout << "Error opening the given file." << std::endl;
     }
 
+    sink = nullptr;
+    pos = 0;
+    written = 0;
+    n = 0;
+    buffer = 0;
+    failed = false;
+    is_initialzied = true;
+}
+
+void BinaryFOut::initialize(std::string file_name, unsigned buffers){
+    /**
+     * Initializer for writing a file asynchronously
+     * A background thread writes each full block while the next
+     * is filled; buffers blocks in total are in use at once
+     * flush() and close() wait for every block to be written,
+     * so they leave the file as the synchronous writer does
+     *
+     * @param file_name Name of file to output to
+     * @param buffers   Number of blocks, 1 or less writes synchronously
+    */
+
+    initialize(file_name);
+    if(buffers < 2 || !file.is_open()) return;
+
+    spare.assign(buffers - 1, std::vector<unsigned char>(block.size()));
+    busy = false;
+    stopping = false;
+    writer = std::thread(&BinaryFOut::write_blocks, this);
+}
+
+void BinaryFOut::write_blocks(){
+    /**
+     * Private member run by the writer thread
+     * Writes filled blocks to file in order and returns them
+     * to spare, until stopped with nothing left to write
+    */
+
+    std::unique_lock<std::mutex> guard(lock);
+    while(true){
+        changed.wait(guard, [&]{ return stopping || !filled.empty(); });
+        if(filled.empty()) return;
+
+        Filled f = std::move(filled.front());
+        filled.pop_front();
+        busy = true;
+        guard.unlock();
+
+        file.write(reinterpret_cast<const char*>(f.bytes.data()), f.count);
+        const bool ok = static_cast<bool>(file);
+
+        guard.lock();
+        if(!ok) failed = true; // Seen by the caller at its next flush() or close()
+        busy = false;
+        spare.push_back(std::move(f.bytes));
+        changed.notify_all();
+    }
+}
+
+void BinaryFOut::wait_written(){
+    /**
+     * Private member that waits until the writer thread
+     * has written every filled block
+     * Does nothing for synchronous output
+    */
+
+    if(!writer.joinable()) return;
+
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard, [&]{ return filled.empty() && !busy; });
+}
+
+void BinaryFOut::initialize(std::vector<unsigned char>& bytes){
+    /**
+     * Initializer for writing to memory instead of a file
+     * Output is appended to bytes a block at a time and
+     * completely once flushed or closed
+     *
+     * @param bytes Vector to append output to, must outlive this object
+     *  or the next close
+    */
+
+    sink = &bytes;
+    append = append_vector<unsigned char>;
+    pos = 0;
+    written = 0;
+    n = 0;
+    buffer = 0;
+    is_initialzied = true;
+}
+
+void BinaryFOut::initialize(std::vector<std::byte>& bytes){
+    /**
+     * Initializer for writing to memory instead of a file
+     * Output is appended to bytes a block at a time and
+     * completely once flushed or closed
+     *
+     * @param bytes Vector to append output to, must outlive this object
+     *  or the next close
+    */
+
+    sink = &bytes;
+    append = append_vector<std::byte>;
+    pos = 0;
+    written = 0;
+    n = 0;
+    buffer = 0;
+    is_initialzied = true;
+}
+
+void BinaryFOut::initialize(std::span<unsigned char> bytes){
+    /**
+     * Initializer for writing into a fixed buffer instead of a file
+     * Output is copied to the front of bytes a block at a time and
+     * completely once flushed or closed; tell() gives how much was used
+     *
+     * @param bytes Buffer to write into, must outlive this object
+     *  or the next close
+    */
+
+    region = bytes;
+    sink = &region;
+    append = append_region;
+    pos = 0;
+    written = 0;
+    n = 0;
+    buffer = 0;
+    is_initialzied = true;
+}
+
+void BinaryFOut::initialize(std::ostream& stream){
+    /**
+     * Initializer for writing to a caller's stream, such as
+     * std::cout or a pipe, instead of a file
+     * Output is written to stream a block at a time, and flushed
+     * once flushed or closed; the stream itself is left open
+     *
+     * @param stream    Stream to write to, must outlive this object
+     *  or the next close
+    */
+
+    sink = &stream;
+    append = append_stream;
+    pos = 0;
+    written = 0;
     n = 0;
     buffer = 0;
     is_initialzied = true;
@@ -41,105 +310,178 @@ void BinaryFOut::initialize(std::string file_name){
 
 void BinaryFOut::close(){
     /**
-     * Closes the file stream and sets object as unitialized
+     * Writes out any buffered bits (padded to a byte),
+     * closes the file stream and sets object as unitialized
+     * A caller's stream is flushed instead of closed
+     *
+     * @throws ofstream::failure if any write to the file or stream
+     *  failed; the object is closed all the same
     */
 
     if(!is_initialzied) return;
 
-    try{
-        file.close();
-        n = -1;
-        buffer = -1;
-        is_initialzied = false;
-    } 
-    catch(const std::ifstream::failure& e){
-       std::cout << "Failed to close file\n" << e.what() << std::endl; 
+    clear_buffer();
+    clear_block();
+    if(append == append_stream && sink != nullptr) flush_stream(sink);
+
+    if(writer.joinable()){
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        changed.notify_all();
+        writer.join();
+        spare.clear();
     }
+
+    const bool to_file = sink == nullptr;
+    if(to_file && file.is_open()) file.close();
+    sink = nullptr;
+    pos = 0;
+    n = -1;
+    buffer = 0;
+    is_initialzied = false;
+    if(to_file) check_written();
+}
+
+bool BinaryFOut::is_open(){
+    /**
+     * @returns True if initialized and not closed, with the
+     *  file, when writing one, successfully opened
+    */
+
+    return is_initialzied && (sink != nullptr || file.is_open());
 }
 
 void BinaryFOut::write_bit(bool bit){
     /**
      * Outpits given bit to file
-     * 
+     *
      * @param bit   bool corresponding to bit to write (f = 0, t = 1)
-     */  
-
-    // Convert bool into char value (0 or 1)
-    char c = (bit) ? 1 : 0;
+     */
 
-    buffer <<= 1;
-    buffer |= c;
-    ++n;
-
-    if(n == 8) clear_buffer();
+    write(bit ? 1 : 0, 1);
 }
 
 void BinaryFOut::write_byte(char byte){
     /**
      * Outputs given byte to file
-     * 
+     *
      * @param byte  char corresponding to byte to write
     */
 
-    // Optimize when buffer at 0 bits (can write byte directly)
-    if(n == 0){
-        buffer = static_cast<unsigned char>(byte);
-        n = 8;
-        clear_buffer();
-        return;
-    }
-
-    // Write bit by bit
-    for(int i=0; i<8; ++i){
-        bool bit = (byte&0x80 == 1) ? 1 : 0;
-        byte <<= 1;
-        write_bit(bit);
-    }
+    write(static_cast<unsigned char>(byte), 8);
 }
 
 void BinaryFOut::clear_buffer(){
     /**
-     * Writes remaining bits in buffer to file
-     * Pads with 0s if necessary
-     * Primary member for interfacing with file
+     * Moves the pending partial byte in the accumulator to the block
+     * Pads the final byte with 0s
     */
 
     if(!is_initialzied) return;
     if(n == 0) return;
 
-    if(n > 0) buffer <<= (8 - n);
-    
-    try{
-        file.write(reinterpret_cast<const char*>(&buffer), sizeof buffer);
-        // file.put(static_cast<char>(buffer));
-        n = 0;
-        buffer = 0;
+    if(pos == block.size()) clear_block();
+    block[pos++] = static_cast<unsigned char>(buffer >> 56); // Bits below n are already 0
+    buffer = 0;
+    n = 0;
+}
+
+void BinaryFOut::clear_block(){
+    /**
+     * Writes the filled part of the block to file
+     * Primary member for interfacing with file
+     * Asynchronous output swaps in a spare block instead and leaves
+     * the write to the writer thread, waiting only if none is spare
+    */
+
+    if(!is_initialzied) return;
+    if(pos == 0) return;
+
+    if(sink != nullptr){
+        const std::size_t count = pos;
+        pos = 0; // Dropped if the sink is full, so close() can still finish
+        append(sink, block.data(), count, written);
+        written += count;
+        return;
     }
-    catch(const std::ifstream::failure& e){
-        std::cout << "Failed to clear buffer\n" << e.what() << std::endl;
+
+    written += pos;
+
+    if(writer.joinable()){
+        std::unique_lock<std::mutex> guard(lock);
+        changed.wait(guard, [&]{ return !spare.empty(); });
+        std::vector<unsigned char> next = std::move(spare.back());
+        spare.pop_back();
+        filled.push_back(Filled{std::move(block), pos});
+        block = std::move(next);
+        pos = 0;
+        changed.notify_all();
+        return;
     }
+
+    file.write(reinterpret_cast<const char*>(block.data()), pos);
+    if(!file) failed = true;
+    pos = 0;
+}
+
+void BinaryFOut::check_written(){
+    /**
+     * Private member that reports a failed write to file, by the
+     * caller or by the writer thread, once the writes are done
+     *
+     * @throws ofstream::failure if any write to file failed
+    */
+
+    bool any;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        any = failed || !file;
+    }
+    if(any) throw(std::ofstream::failure("Failed to write output"));
 }
 
 void BinaryFOut::flush(){
-    /** 
+    /**
      * Flushes the file contents
+     * Pending bits are padded out to a whole byte
+     * Asynchronous output first waits for every block to be written
     */
 
     clear_buffer();
+    clear_block();
+    if(append == append_stream && sink != nullptr) flush_stream(sink);
+    if(sink != nullptr) return;
+    wait_written();
+    file.flush();
+    check_written();
+}
 
-    try{
-        file.flush();
-    }
-    catch(const std::ifstream::failure& e){
-        std::cout << "Failed to flush to file\n" << e.what() << std::endl;
-    }
+void BinaryFOut::drain(){
+    /**
+     * Passes every whole byte written so far to the file or sink
+     * Unlike flush, a pending partial byte is not padded and stays
+     * pending, so later writes continue the same bit stream
+    */
+
+    clear_block();
+}
+
+std::size_t BinaryFOut::tell(){
+    /**
+     * @returns Number of whole bytes written so far,
+     *  not counting a pending partial byte
+    */
+
+    return written + pos;
 }
 
 void BinaryFOut::write(bool bit){
     /**
      * Public member to add the given bit
      * (represented as bool) to the buffer
-     * 
+     *
      * @param bit   bool representing bit to write
     */
 
@@ -150,7 +492,7 @@ void BinaryFOut::write(char byte){
     /**
      * Public member to add the given byte
      * (represented as char) to the buffer
-     * 
+     *
      * @param byte  char representing byte to write
     */
 
@@ -162,13 +504,11 @@ void BinaryFOut::write(short dbyte){
      * Public member to add given 16 bits
      * ("d"ouble byte, represented as char) to
      * the buffer
-     * 
+     *
      * @param dbyte short representing the 16 bits to write
     */
 
-    // Make unsigned for right shift
-    unsigned short u_dbyte = static_cast<unsigned short>(dbyte);
-    write_byte(static_cast<char>(u_dbyte >> 8));
+    write(static_cast<unsigned short>(dbyte), 16);
 }
 
 void BinaryFOut::write(int qbyte){
@@ -176,17 +516,11 @@ void BinaryFOut::write(int qbyte){
      * Public member to add given 32 bits
      * ("q"uad byte, represented as int) to
      * the buffer
-     * 
+     *
      * @param qbyte int representing the 32 bits to write
     */
 
-    // Make unsigned for right shifting
-    unsigned int u_qbyte = static_cast<unsigned int>(qbyte);
-
-    write_byte(static_cast<char>(u_qbyte >> 24));
-    write_byte(static_cast<char>(u_qbyte >> 16));
-    write_byte(static_cast<char>(u_qbyte >> 8));
-    write_byte(static_cast<char>(u_qbyte));
+    write(qbyte, 32);
 }
 
 void BinaryFOut::write(long obyte){
@@ -194,51 +528,125 @@ void BinaryFOut::write(long obyte){
      * Public member to add given 64 bits
      * ("o"cto byte, reprsented as a long) to
      * the buffer
-     * 
+     *
      * @param obyte long representing the 64 bits to write
     */
 
     // Make unsigned for right shifting
     unsigned long u_obyte = static_cast<unsigned long>(obyte);
 
-    write(static_cast<int>(u_obyte >> 32));
-    write(static_cast<int>(u_obyte));
+    write(static_cast<int>(u_obyte >> 32), 32);
+    write(static_cast<int>(u_obyte), 32);
 }
 
 void BinaryFOut::write(int c, int r){
     /**
      * Public member to add given r bits
      * from int c
-     * 
+     *
      * @param c value whose bits are to be written
      * @param r number of bits (big endian) of importance in c
+     * @throws invalid_argument if r not between 1 and 32
     */
-    
-    // Optimize 32 bit case
-    if(r == 32){
-        write(c);
-        return;
+
+    if(!(r>=1 && r<=32)){
+        throw(std::invalid_argument("Number of bits to write must be between 1 and 32"));
     }
+    if(!is_initialzied) return;
+
+    if(pos + 8 > block.size()) clear_block();
+    put_bits(static_cast<unsigned int>(c), r);
+}
 
-    // Make unsiged for right shifting
-    unsigned int w = static_cast<unsigned int>(c);
-    for(int i=0; i<r; i++){
-        bool bit = ((w >> (r -  i - 1)) & 1) == 1;
-        write_bit(bit);
+void BinaryFOut::write(std::span<const int> codes, int r){
+    /**
+     * Public member to add r bits from each codeword in codes
+     * Room in the block is checked once per run of codewords
+     * rather than once per codeword
+     * Each LZW codeword width has its own loop with r folded in
+     *
+     * @param codes Codewords whose bits are to be written
+     * @param r number of bits (big endian) of importance in each codeword
+     * @throws invalid_argument if r not between 1 and 32
+    */
+
+    if(!(r>=1 && r<=32)){
+        throw(std::invalid_argument("Number of bits to write must be between 1 and 32"));
+    }
+    if(!is_initialzied) return;
+
+    switch(r){
+        case 9: write_codes<9>(codes, r); break;
+        case 10: write_codes<10>(codes, r); break;
+        case 11: write_codes<11>(codes, r); break;
+        case 12: write_codes<12>(codes, r); break;
+        case 13: write_codes<13>(codes, r); break;
+        case 14: write_codes<14>(codes, r); break;
+        case 15: write_codes<15>(codes, r); break;
+        case 16: write_codes<16>(codes, r); break;
+        case 17: write_codes<17>(codes, r); break;
+        case 18: write_codes<18>(codes, r); break;
+        case 19: write_codes<19>(codes, r); break;
+        case 20: write_codes<20>(codes, r); break;
+        default: write_codes<0>(codes, r);
     }
 }
 
+template<int R>
+void BinaryFOut::write_codes(std::span<const int> codes, int width){
+    /**
+     * Private member for write() of codewords
+     *
+     * @param codes Codewords whose bits are to be written
+     * @param width number of bits of each codeword, equal to R unless R is 0
+    */
+
+    const int r = R > 0 ? R : width;
+    std::size_t i = 0;
+    while(i < codes.size()){
+        if(pos + 8 > block.size()) clear_block();
+
+        // Each codeword advances pos by at most r/8 + 1 bytes
+        std::size_t room = (block.size() - pos - 8) / (r / 8 + 1) + 1;
+        std::size_t run = std::min(codes.size() - i, room);
+        for(std::size_t k=0; k<run; ++k){
+            put_bits(static_cast<unsigned int>(codes[i++]), r);
+        }
+    }
+}
+
+void BinaryFOut::put_bits(uint64_t w, int r){
+    /**
+     * Private member that inserts the low r bits of w below the
+     * n pending bits and stores the accumulator into the block
+     * Advances by the whole bytes stored and keeps the rest pending
+     * Assumes at least 8 bytes of room in the block
+     *
+     * @param w Value whose low r bits are to be written
+     * @param r number of bits, between 1 and 32
+    */
+
+    w &= (uint64_t(1) << r) - 1;
+    buffer |= w << (64 - n - r);
+    n += r;
+
+    store_be64(block.data() + pos, buffer);
+    pos += n >> 3;
+    buffer <<= (n & ~7);
+    n &= 7;
+}
+
 void BinaryFOut::write(std::string s, int r){
     /**
      * Public member to write string with character size
      * of a given bit length
-     * 
+     *
      * @param s String to write to buffer
      * @param r int specifying bit-width of characters in s
     */
 
-    for(int i=0; i<s.length(); i++){
-        write(s.at(i), r);
+    for(std::size_t i=0; i<s.length(); i++){
+        write(static_cast<unsigned char>(s[i]), r);
     }
 }
 
@@ -247,11 +655,36 @@ void BinaryFOut::write(std::string s){
     /**
      * Public member to write string of 8-bit characters
      * to file
-     * 
+     *
      * @param s String to write to buffer
     */
 
-    for(int i=0; i<s.length(); ++i){
-        write(s.at(i));
+    write_bytes(s.data(), s.length());
+}
+
+void BinaryFOut::write_bytes(const char* s, std::size_t count){
+    /**
+     * Public member to write count 8-bit characters to file
+     * When byte-aligned, bytes are copied straight into the block
+     *
+     * @param s     Bytes to write
+     * @param count Number of bytes in s
+    */
+
+    if(!is_initialzied) return;
+
+    // Not byte-aligned, every byte straddles two bytes of the file
+    if(n != 0){
+        for(std::size_t i=0; i<count; ++i) write_byte(s[i]);
+        return;
     }
-}
\ No newline at end of file
+
+    std::size_t i = 0;
+    while(i < count){
+        if(pos == block.size()) clear_block();
+        std::size_t take = std::min(count - i, block.size() - pos);
+        std::memcpy(block.data() + pos, s + i, take);
+        pos += take;
+        i += take;
+    }
+}
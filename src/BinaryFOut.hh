@@ -4,30 +4,76 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 class BinaryFOut{
     private:
         std::ofstream file; // file to write to
-        unsigned char buffer; // 1-byte buffer to maintain
-        int n;  // number of bits remaining in buffer
+        std::vector<unsigned char> block; // block of bytes written to file at once
+        std::size_t pos; // number of bytes used in block
+        std::size_t written; // number of bytes passed to the file or sink so far
+        void* sink; // caller's memory to write to instead of a file (nullptr for file)
+        void (*append)(void* sink, const unsigned char* bytes, std::size_t count, std::size_t offset); // writes to sink
+        std::span<unsigned char> region; // caller's fixed buffer, when sink points to it
+        uint64_t buffer; // bit accumulator, pending n bits are its high bits (MSB first)
+        int n;  // number of bits pending in buffer, always less than 8 between writes
         bool is_initialzied; // flag to check initialization
+        struct Filled{
+            std::vector<unsigned char> bytes; // block handed to the writer thread
+            std::size_t count; // number of bytes used in it
+        };
+        std::thread writer; // writes filled blocks to file, running only for asynchronous output
+        std::mutex lock; // guards filled, spare, busy and stopping
+        std::condition_variable changed; // signalled whenever a guarded member changes
+        std::deque<Filled> filled; // blocks waiting to be written, oldest first
+        std::vector<std::vector<unsigned char>> spare; // written blocks free to fill again
+        bool busy; // writer thread is writing a block outside the lock
+        bool stopping; // writer thread exits once filled is empty
+        bool failed; // a write to file has failed, guarded by lock while the writer thread runs
+        void check_written();
+        void write_blocks();
+        void wait_written();
         void write_bit(bool bit);
         void write_byte(char byte);
         void clear_buffer();
-    
+        void clear_block();
+        void put_bits(uint64_t w, int r);
+        template<int R>
+        void write_codes(std::span<const int> codes, int width);
+
     public:
+        static const std::size_t DEFAULT_BLOCK_SIZE = 1 << 16; // 64 KiB
         BinaryFOut();
+        BinaryFOut(std::size_t block_size); // Write to the file block_size bytes at a time
+        ~BinaryFOut();
         void initialize(std::string file_name);
+        void initialize(std::string file_name, unsigned buffers); // write the file on a background thread
+        void initialize(std::vector<unsigned char>& bytes); // append to memory instead of a file
+        void initialize(std::vector<std::byte>& bytes); // append to memory instead of a file
+        void initialize(std::span<unsigned char> bytes); // fill a fixed buffer instead of a file
+        void initialize(std::ostream& stream); // write to a caller's stream (such as std::cout)
         void flush();
+        void drain(); // write out whole bytes, keeping pending bits pending
+        std::size_t tell(); // number of whole bytes written so far
         void close();
+        bool is_open(); // whether the output was initialized successfully
         void write(bool bit); // write single bit
         void write(char byte); // write single byte
         void write(short dbyte); // write 16 bits (2 bytes or "d"ouble byte)
         void write(int w, int r); // write w which has r bits
+        void write(std::span<const int> codes, int r); // write codewords which have r bits each
         void write(int qbyte); // write 32 bits (4 bytes or "q"uad byte)
         void write(long obyte); // write 64 bits (8 bytes or "o"cto byte)
         void write(std::string s, int r); // write string s of r-bit characters
         void write(std::string s); // write string s of 8-bit characters
+        void write_bytes(const char* s, std::size_t count); // write count 8-bit characters
 };
 
-#endif
\ No newline at end of file
+#endif
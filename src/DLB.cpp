@@ -57,6 +57,7 @@ void DLB::put(std::string s, int key){
                     traverse->down = nullptr;
                     traverse->right = nullptr;
                 }
+                else traverse = traverse->down;
            }
         }
         /* Case where node for character must be created */
@@ -110,6 +111,7 @@ std::string DLB::longest_prefix_of(std::string s){
     std::shared_ptr<DLB_Node> traverse(head); // Node for traversal
     /* Iterate over characters in s one by one, building prefix string */ 
     for(auto &ch : s){
+        if(traverse == nullptr) break; // Matched a leaf, nothing below it
         while((traverse->c != ch) && (traverse->right != nullptr)) traverse = traverse->right;
         /* Check if traverse is at proper character */
         if(traverse->c != ch) break;
@@ -136,6 +138,7 @@ int DLB::get(std::string s){
     std::shared_ptr<DLB_Node> traverse(head); // Node for traversal
     std::shared_ptr<DLB_Node> holds_final; // Node that will be used to return key
     for(auto &ch : s){
+        if(traverse == nullptr) throw std::invalid_argument("String not in trie");
         while((traverse->c != ch) && (traverse->right != nullptr)) traverse = traverse->right;
         /* Check if traverse is at proper character */
         if(traverse->c != ch) throw std::invalid_argument("String not in trie");
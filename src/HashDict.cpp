@@ -0,0 +1,124 @@
+/**
+ * Implementation of a hash table dictionary for LZW encoding
+ *
+ * Offers the node-level interface of ArenaDLB, but a string is
+ * identified by its key and extended through an open-addressing
+ * table keyed on (prefix key, next character), so finding a child
+ * is one hash and a short probe instead of a walk along a sibling list
+ * The table is one flat array of 8-byte slots, sized once to at
+ * least twice the number of keys so it stays at most half full
+ * and, for the usual widths, cache resident
+ * The first level is a direct table indexed by character
+ * Slots are tagged with the generation they were stored in, so
+ * clearing only moves to the next generation; the table is wiped
+ * once every 255 clears, when the tags run out
+ * Restoring a trained dictionary pins the slots its strings occupy
+ * under a generation above every other, so they stay in use while
+ * each later restore only moves to the next generation
+*/
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include "HashDict.hh"
+
+HashDict::HashDict() : HashDict(1 << 12){
+}
+
+HashDict::HashDict(std::size_t capacity){
+    /**
+     * Initialize an empty dictionary with room for
+     * keys 0 to capacity-1
+     *
+     * @param capacity  Number of keys to size the table for
+     * @throws invalid_argument if capacity is larger than MAX_KEY + 1
+    */
+
+    if(capacity > MAX_KEY + std::size_t(1)){
+        throw(std::invalid_argument("Dictionary capacity too large"));
+    }
+
+    const std::size_t size = std::bit_ceil(std::max<std::size_t>(2 * capacity, 256));
+    slots.resize(size);
+    mask = static_cast<uint32_t>(size - 1);
+    shift = 32 - std::countr_zero(size);
+    generation = MAX_GENERATION; // So clear() wipes the new table
+    clear();
+}
+
+void HashDict::clear(){
+    /**
+     * Removes every string from the dictionary
+     * Starts a new generation, leaving every slot of the old one
+     * unused, so this is O(1) (plus clearing the fixed 256 entry
+     * first level) except when the generations wrap around, or
+     * restore() pinned slots, and the table is wiped; the table's
+     * storage is kept for reuse
+    */
+
+    if(++generation > MAX_GENERATION || pinned != nullptr){
+        std::fill(slots.begin(), slots.end(), Slot{0, 0});
+        generation = 1;
+        pinned = nullptr;
+    }
+    std::fill(roots, roots + 256, NIL);
+    count = 0;
+}
+
+void HashDict::seal(){
+    /**
+     * Lists the slots in use, for restore() to copy
+     * Scans the whole table, so it is for a dictionary built once
+     * and restored from many times; nothing is added after it
+    */
+
+    const uint32_t tag = generation << KEY_BITS;
+    sealed.clear();
+    for(std::size_t i=0; i<slots.size(); ++i){
+        if(slots[i].key >= tag) sealed.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+void HashDict::restore(const HashDict& primed){
+    /**
+     * Replaces every string with the strings of primed
+     * primed's slots in use are copied, each to the same place so
+     * every probe finds its string as it does in primed, and pinned:
+     * they stay in use in every generation, and strings added later
+     * probe past them
+     * Restoring from the same dictionary again only starts a new
+     * generation, leaving the strings added since to the old one,
+     * so it costs the first level, not the table or the number of
+     * primed strings; the table is wiped and the slots copied again
+     * when the generations run out
+     *
+     * @param primed    Dictionary to copy the strings of, sealed after
+     *  its last string was added
+     * @throws invalid_argument if primed's table is a different size
+    */
+
+    if(primed.slots.size() != slots.size()){
+        throw(std::invalid_argument("Dictionary capacities differ"));
+    }
+
+    if(pinned == &primed && generation < MAX_GENERATION){
+        generation++;
+    }
+    else{
+        std::fill(slots.begin(), slots.end(), Slot{0, 0});
+        generation = 1;
+        for(const uint32_t i : primed.sealed){
+            slots[i] = Slot{primed.slots[i].pair, (PINNED << KEY_BITS) | (primed.slots[i].key & KEY_MASK)};
+        }
+        pinned = &primed;
+    }
+    std::copy(primed.roots, primed.roots + 256, roots);
+    count = primed.count;
+}
+
+std::size_t HashDict::size(){
+    /**
+     * @returns Number of strings in the dictionary
+    */
+
+    return count;
+}
@@ -0,0 +1,142 @@
+#ifndef HASH_DICT
+#define HASH_DICT
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+#include "LZWStats.hh"
+
+class HashDict{
+    private:
+        struct Slot{
+            /**
+             * Private struct for one entry of the open-addressing table
+             * Maps (prefix key, next character) to the key of the
+             * string that extends the prefix by that character
+             * A slot is in use only if it was stored in the current
+             * generation, or pinned by restore(), so clear() empties
+             * every other slot at once
+            */
+
+            uint32_t pair; // (prefix key << 8) | character
+            uint32_t key; // Key of the extended string, with its generation in the top 8 bits
+        };
+        static constexpr int KEY_BITS = 24; // Bits of Slot::key holding the key
+        static constexpr uint32_t KEY_MASK = (1u << KEY_BITS) - 1;
+        static constexpr uint32_t MAX_GENERATION = 0xfe; // Generations run from 1; 0 tags slots never used
+        static constexpr uint32_t PINNED = 0xff; // Generation of slots restored from a sealed dictionary, above every other
+        std::vector<Slot> slots; // Power of two size, at most half full
+        uint32_t generation; // Generation of the slots in use, changed by every clear()
+        uint32_t mask; // slots.size() - 1
+        int shift; // 32 - log2(slots.size()), for the multiplicative hash
+        uint32_t roots[256]; // First level, node of each single character (NIL if none)
+        std::size_t count; // Number of strings stored
+        uint64_t visits = 0; // Slots looked at by child(), counted only if LZW_STATS_ENABLED
+        std::vector<uint32_t> sealed; // Slots in use when seal() was last called
+        const HashDict* pinned = nullptr; // Sealed dictionary whose slots are pinned in the table, nullptr for none
+        uint32_t slot_of(uint32_t pair); // First slot to probe for pair
+
+    public:
+        static constexpr uint32_t NIL = 0; // Node of no string
+        static const uint32_t MAX_KEY = (1u << 24) - 2; // Largest key that can be stored
+        HashDict();
+        HashDict(std::size_t capacity); // Size the table for keys 0 to capacity-1
+        void clear(); // Remove every string, keeping the table's storage
+        void seal(); // List the slots in use, so restore() from this dictionary copies only them
+        void restore(const HashDict& primed); // Hold exactly the strings of a sealed dictionary of the same capacity
+        std::size_t size(); // Number of strings stored
+
+        /* Node-level access for walking the dictionary one character at a time */
+        uint32_t child(uint32_t node, char c); // Child of node for c (NIL node is the first level)
+        uint32_t add_child(uint32_t node, char c, int key); // Insert c below node with key
+        int key_of(uint32_t node); // Key stored at node
+        uint64_t visited(); // Slots looked at by child() so far, with LZW_STATS
+};
+
+/* Node-level members are inline so encoders walking the dictionary inline them */
+
+inline uint32_t HashDict::slot_of(uint32_t pair){
+    /**
+     * Private member hashing a pair to its home slot
+     * Fibonacci hashing keeps the high bits of the product
+     *
+     * @param pair  (prefix key << 8) | character
+     * @returns Index of the first slot to probe
+    */
+
+    return static_cast<uint32_t>(pair * 2654435769u) >> shift;
+}
+
+inline uint32_t HashDict::child(uint32_t node, char c){
+    /**
+     * Finds the node for the string of node extended by c
+     * A node is its string's key plus one, so NIL stays 0
+     *
+     * @param node  Node to extend, NIL for the first level
+     * @param c Character to extend by
+     * @returns Node of the extended string, NIL if it is not stored
+    */
+
+    if constexpr(LZW_STATS_ENABLED) visits++;
+    if(node == NIL) return roots[static_cast<unsigned char>(c)];
+
+    const uint32_t pair = ((node - 1) << 8) | static_cast<unsigned char>(c);
+    const uint32_t tag = generation << KEY_BITS;
+    for(uint32_t i = slot_of(pair); ; i = (i + 1) & mask){
+        if constexpr(LZW_STATS_ENABLED) visits++;
+        const Slot& s = slots[i];
+        if(s.key < tag) return NIL; // Empty, or stored before the last clear()
+        if(s.pair == pair) return (s.key & KEY_MASK) + 1;
+    }
+}
+
+inline uint32_t HashDict::add_child(uint32_t node, char c, int key){
+    /**
+     * Stores the string of node extended by c with key
+     * Assumes the string is not already stored (child() returned NIL)
+     * and that every key is stored at most once
+     *
+     * @param node  Node to extend, NIL for the first level
+     * @param c Character to extend by
+     * @param key   Key of the extended string, below the capacity
+     * @returns Node of the extended string
+    */
+
+    if(node == NIL){
+        roots[static_cast<unsigned char>(c)] = static_cast<uint32_t>(key) + 1;
+    }
+    else{
+        const uint32_t pair = ((node - 1) << 8) | static_cast<unsigned char>(c);
+        const uint32_t tag = generation << KEY_BITS;
+        uint32_t i = slot_of(pair);
+        while(slots[i].key >= tag) i = (i + 1) & mask;
+        slots[i] = Slot{pair, tag | static_cast<uint32_t>(key)};
+    }
+
+    count++;
+    return static_cast<uint32_t>(key) + 1;
+}
+
+inline int HashDict::key_of(uint32_t node){
+    /**
+     * @param node  Node returned by child() or add_child()
+     * @returns Key of the node's string
+     * @throws invalid_argument for the NIL node
+    */
+
+    if(node == NIL) throw std::invalid_argument("No key at node");
+    return static_cast<int>(node - 1);
+}
+
+inline uint64_t HashDict::visited(){
+    /**
+     * @returns Number of first-level entries and slots child() has
+     *  looked at, across clears; always 0 unless LZW_STATS_ENABLED
+    */
+
+    return visits;
+}
+
+#endif
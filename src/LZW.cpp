@@ -1,114 +1,1117 @@
 /**
  * Implementation of LZW compression algorithm
  * wrapped in LZW class
- * Compresses with fixed-length codewords
+ * Compresses with variable-length codewords that start at
+ * min_width bits and grow to max_width bits as the dictionary
+ * fills; once full the dictionary is either reset (signalled by
+ * the CLEAR codeword) or frozen
  * Supports loss-less compression and expansion of
  * any file
- * 
+ *
+ * By default the input is split into fixed-size blocks, each
+ * compressed with its own dictionary on a pool of threads and
+ * located through an index at the end of the file, so blocks
+ * are also expanded in parallel, and any byte range can be
+ * expanded by decoding only the blocks that cover it
+ *
+ * A single stream can instead carry sync points: a dictionary reset
+ * every sync_interval codewords, with the bit offset of each recorded
+ * in an index after the stream, so its parts are expanded in parallel
+ * straight into their places in the output; the ratio lost to the
+ * resets shrinks as the interval grows
+ *
+ * Each block's codewords can also be Huffman coded (LZWEntropy),
+ * with a code fitted to the block stored at its start, so blocks
+ * still expand independently
+ *
+ * Small messages can start from a trained LZWDictionary instead of
+ * the single characters; its id is recorded in the header and the
+ * same dictionary must be given to expand
+ *
+ * Files are named by the caller; the static members
+ * work on memory instead, writing no files at all
+ *
  * Based off of LZW.java
  * https://algs4.cs.princeton.edu/55compression/LZW.java.html
- * 
+ *
  * DEPENDENCIES:
- *  DLB
  *  BinaryFIn
  *  BinaryFOut
+ *  LZWHeader
+ *  LZWDictionary
+ *  LZWEntropy
+ *  LZWEncoder
+ *  ArenaDLB, HashDict, SimdDLB or PoolDLB, picked by the template parameter
+ *  LZWDecoder
+ *  LZWStats
+ *  OrderedPipeline
 */
 
 #include <stdexcept>
 #include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <algorithm>
 
-#include "DLB.hh"
 #include "BinaryFIn.hh"
 #include "BinaryFOut.hh"
+#include "LZWHeader.hh"
+#include "LZWDictionary.hh"
+#include "LZWEntropy.hh"
+#include "LZWEncoder.hh"
+#include "LZWDecoder.hh"
+#include "LZWStats.hh"
+#include "OrderedPipeline.hh"
 
 #include "LZW.hh"
 
-LZW::LZW(std::string file_name){
+template<class Dict, class Read, class View, class Done>
+static void compress_blocks(unsigned threads, const LZWHeader& h, int effort, BinaryFOut& out, Read read, View view,
+    Done done, LZWStats& stats){
     /**
-     *  Only accepted constructor
-     *  Takes name of file to compress and initializes fields 
+     * Compresses input as independent blocks
+     * Blocks are read in order, compressed in parallel, each with
+     * its own dictionary, and written in order followed by the index
+     *
+     * @param threads   Number of worker threads
+     * @param h Header already written to out
+     * @param effort    Shorter matches the encoder tries at each codeword
+     * @param out   Output positioned after the header
+     * @param read  read(index, in) -> bool, false once there are no more blocks
+     *  Either fills in with the block or leaves it for view to find
+     * @param view  view(index, in) -> span of the block's bytes
+     * @param done  done(index, in), called once the block is encoded
+     * @param stats Statistics to add every block's counters to
     */
 
+    LZWBlockIndex index;
+    std::mutex m; // Guards stats, added to by every worker
+    double writing = 0; // Time writing blocks, on this thread
+
+    ordered_pipeline(threads, read,
+        [&](std::size_t i, const std::vector<unsigned char>& in, std::vector<unsigned char>& block){
+            BinaryFOut block_out;
+            block_out.initialize(block);
+            BasicLZWEncoder<Dict> encoder(h, block_out, effort);
+            encoder.encode(view(i, in));
+            encoder.finish();
+            block_out.close();
+            done(i, in);
+
+            LZWStats s = encoder.statistics();
+            s.bytes_out = block.size();
+            std::lock_guard<std::mutex> lock(m);
+            stats.add(s);
+        },
+        [&](std::size_t i, const std::vector<unsigned char>& in, const std::vector<unsigned char>& block){
+            LZWTimer timer(writing);
+            index.blocks.push_back({out.tell(), block.size(), view(i, in).size()});
+            out.write_bytes(reinterpret_cast<const char*>(block.data()), block.size());
+        });
+
+    index.write(out);
+    stats.io_seconds += writing;
+    stats.blocks = index.blocks.size();
+}
+
+static LZWStats expand_block(const LZWHeader& h, std::span<const unsigned char> in, std::span<unsigned char> out){
+    /**
+     * Expands one block straight into memory
+     *
+     * @param h Header of the file holding the block
+     * @param in    Compressed block
+     * @param out   Buffer for the block alone, exactly the size it must expand to
+     * @returns Counters for decoding the block
+     * @throws invalid_argument if the block does not expand to out's size
+    */
+
+    LZWDecoder decoder(h);
+    if(decoder.decode(in, out) != out.size()){
+        throw(std::invalid_argument("Corrupt compressed file"));
+    }
+    return decoder.statistics();
+}
+
+static uint64_t part_end(const LZWSyncIndex& index, std::size_t i){
+    /**
+     * @param index Index of every part of a stream
+     * @param i Number of a part
+     * @returns Byte offset just past the last byte holding the part's codewords
+    */
+
+    return i + 1 < index.parts.size() ? (index.parts[i+1].bit_offset + 7) / 8 : index.end;
+}
+
+static std::vector<std::size_t> part_runs(const LZWSyncIndex& index){
+    /**
+     * Groups consecutive parts into runs of at least RUN bytes of
+     * output, so a short sync interval does not cost a decoder and
+     * a trip through the pipeline for every part
+     *
+     * @param index Index of every part of a stream
+     * @returns Number of the first part of every run, then the number of parts
+    */
+
+    static const uint64_t RUN = 1 << 20; // Bytes of output decoded per run
+    std::vector<std::size_t> runs;
+    uint64_t size = RUN;
+    for(std::size_t i=0; i<index.parts.size(); ++i){
+        if(size >= RUN){
+            runs.push_back(i);
+            size = 0;
+        }
+        size += index.parts[i].raw_size;
+    }
+    runs.push_back(index.parts.size());
+    return runs;
+}
+
+static LZWStats expand_run(const LZWHeader& h, const LZWSyncIndex& index, std::size_t first, std::size_t last,
+    std::span<const unsigned char> in, BinaryFOut& out){
+    /**
+     * Expands a run of parts of a stream with sync points, one after
+     * another with one decoder, and closes out
+     * Every part but the last of the stream stops after its raw_size
+     * bytes, just before the CLEAR of the sync point that ends it
+     *
+     * @param h Header of the file holding the parts
+     * @param index Index of every part
+     * @param first Number of the first part of the run
+     * @param last  Number of the part after the run
+     * @param in    Bytes of the file from the one holding the first part's first codeword
+     * @param out   Output for the run alone
+     * @returns Counters for decoding the run
+     * @throws invalid_argument if a part does not expand to its raw_size
+    */
+
+    const uint64_t base = index.parts[first].bit_offset / 8; // Offset of in in the file
+    LZWDecoder decoder(h);
+    LZWStats stats;
+    for(std::size_t i=first; i<last; ++i){
+        const LZWSyncIndex::Entry& e = index.parts[i];
+        const uint64_t from = e.bit_offset / 8 - base;
+        BinaryFIn part_in;
+        part_in.initialize(in.subspan(from, part_end(index, i) - base - from));
+        if(e.bit_offset % 8 > 0) part_in.read_r(static_cast<int>(e.bit_offset % 8));
+
+        const bool end_of_stream = i + 1 == index.parts.size();
+        const std::size_t before = out.tell();
+        decoder.start();
+        const bool whole = decoder.resume(part_in, out, end_of_stream ? std::numeric_limits<std::size_t>::max() : before + e.raw_size);
+        if(!whole || out.tell() - before != e.raw_size){
+            throw(std::invalid_argument("Corrupt compressed file"));
+        }
+        stats.add(decoder.statistics());
+    }
+    out.close();
+    return stats;
+}
+
+template<class Entry>
+static std::size_t raw_total(const std::vector<Entry>& entries, std::size_t limit, uint64_t bound){
+    /**
+     * Adds up the uncompressed sizes of the blocks or parts
+     *
+     * @param entries   Index entry of every block or part
+     * @param limit Largest total that fits where it is going
+     * @param bound Most the whole file can expand to
+     * @returns Uncompressed size of the file
+     * @throws invalid_argument if the total is larger than bound or limit
+    */
+
+    uint64_t total = 0;
+    for(const Entry& e : entries){
+        if(e.raw_size > bound - total) throw(std::invalid_argument("Corrupt compressed file"));
+        total += e.raw_size;
+    }
+    if(total > limit) throw(std::invalid_argument("Output buffer is too small"));
+    return static_cast<std::size_t>(total);
+}
+
+template<class Dict>
+BasicLZW<Dict>::BasicLZW(std::string file_name) : BasicLZW(file_name, LZWOptions()){
+}
+
+template<class Dict>
+BasicLZW<Dict>::BasicLZW(std::string file_name, LZWOptions options){
+    /**
+     *  Constructor with compression settings
+     *  Takes name of file to compress and initializes fields
+     *
+     *  @param file_name    Name of file to compress
+     *  @param options      Codeword widths, what to do when the dictionary fills
+     *      and how to split the work into blocks
+     *  @throws invalid_argument if the settings are out of range
+    */
+
+    header(options);
     file = file_name;
+    this->options = options;
+}
+
+template<class Dict>
+LZWHeader BasicLZW<Dict>::header(const LZWOptions& options){
+    /**
+     * Builds the header for the compression settings
+     *
+     * @param options   Compression settings
+     * @returns Header to write at the start of the compressed file
+     * @throws invalid_argument if the settings are out of range
+    */
+
+    if(options.block_size > std::numeric_limits<uint32_t>::max()){
+        throw(std::invalid_argument("Block size must fit in 32 bits"));
+    }
+    if(options.sync_interval > std::numeric_limits<uint32_t>::max()){
+        throw(std::invalid_argument("Sync interval must fit in 32 bits"));
+    }
+    if(options.sync_interval > 0 && options.block_size > 0){
+        throw(std::invalid_argument("Sync points need a block size of 0"));
+    }
+    if(options.huffman && options.block_size == 0){
+        throw(std::invalid_argument("Huffman coding needs a block size above 0"));
+    }
+    if(options.effort < 0 || options.effort > BasicLZWEncoder<Dict>::MAX_EFFORT){
+        throw(std::invalid_argument("Effort must be from 0 to 16"));
+    }
+
+    LZWHeader h;
+    h.flags = options.reset ? LZWHeader::RESET : 0;
+    if(options.block_size > 0) h.flags |= LZWHeader::BLOCKS;
+    h.min_width = options.min_width;
+    h.max_width = options.max_width;
+    h.block_size = static_cast<uint32_t>(options.block_size);
+    if(options.sync_interval > 0) h.flags |= LZWHeader::SYNC;
+    h.sync_interval = static_cast<uint32_t>(options.sync_interval);
+    if(options.dictionary != nullptr){
+        h.flags |= LZWHeader::DICT;
+        h.dictionary_id = options.dictionary->id();
+        h.dictionary = options.dictionary;
+    }
+    if(options.huffman) h.flags |= LZWHeader::HUFFMAN;
+    h.validate();
+    return h;
 }
 
-void LZW::compress(){
+template<class Dict>
+unsigned BasicLZW<Dict>::thread_count(unsigned threads){
+    /**
+     * Private member to resolve the number of worker threads
+     *
+     * @param threads   Requested number of threads
+     * @returns threads, or the number of cores if it is 0
+    */
+
+    if(threads > 0) return threads;
+    unsigned cores = std::thread::hardware_concurrency();
+    return cores > 0 ? cores : 1;
+}
+
+template<class Dict>
+LZWStats BasicLZW<Dict>::compress(){
     /**
      * Compresses the given file using LZW
      * compression algorithm
      * Outputs the compressed file as "compress.lzw"
+     *
+     * @returns Statistics of the compression
+    */
+
+    return compress(std::string("compress.lzw"));
+}
+
+template<class Dict>
+LZWStats BasicLZW<Dict>::compress(const std::string& output){
+    /**
+     * Compresses the given file into the file output
+     *
+     * @param output    Name of the compressed file to write
+     * @returns Statistics of the compression
+     * @throws ifstream::failure if either file cannot be opened
+     * @throws ofstream::failure if writing output fails
     */
 
-    /* Initialize file I/O objects */
-    BinaryFIn file_in;
-    file_in.initialize(file);
     BinaryFOut file_out;
-    file_out.initialize("compress.lzw");
+    file_out.initialize(output, options.output_buffers);
+    if(!file_out.is_open()) throw(std::ofstream::failure("Cannot create " + output));
+    return compress_file(file_out);
+}
 
-    DLB st; // Symbol table
+template<class Dict>
+LZWStats BasicLZW<Dict>::compress(std::ostream& out){
+    /**
+     * Compresses the given file into a stream, such as std::cout
+     *
+     * @param out   Stream for the compressed bytes, flushed on return
+     * @returns Statistics of the compression
+     * @throws ifstream::failure if the file cannot be opened
+     * @throws ofstream::failure if writing to out fails
+    */
 
-    /* Initialize symbol table */
-    for(int i=0; i<R; ++i){
-        st.put(static_cast<char>(i), i);
-    }
-    int code = R+1;
+    BinaryFOut stream_out;
+    stream_out.initialize(out);
+    return compress_file(stream_out);
+}
+
+template<class Dict>
+LZWStats BasicLZW<Dict>::compress_file(BinaryFOut& out){
+    /**
+     * Private member to compress the given file
+     *
+     * The file is memory mapped when possible and encoded straight
+     * from the mapping, so it is never copied
+     * Otherwise it is read in blocks, or with a block size of 0
+     * in bounded windows, so any size is handled in linear time
+     *
+     * @param out   Output for the compressed file, closed on return
+     * @returns Statistics of the compression
+     * @throws ifstream::failure if the file cannot be opened
+    */
 
-    std::string input(file_in.read_string());
-    while(input.length() > 0){
-        std::string s = st.longest_prefix_of(input); // prefix match s
-        file_out.write(st.get(s), W); // output s's encoding
-        int t = s.length();
-        if(t < input.length() && code < L){
-            st.put(input.substr(0, t+1), code);
-            code++;
+    BinaryFIn file_in;
+    const bool mapped = file_in.initialize_mapped(file);
+    if(!mapped) file_in.initialize(file);
+    if(!file_in.is_open()) throw(std::ifstream::failure("Cannot open " + file));
+
+    if(mapped) return compress(file_in.bytes(), out, options, &file_in);
+    return compress(file_in, out, options);
+}
+
+template<class Dict>
+LZWStats BasicLZW<Dict>::compress(std::istream& in, std::ostream& out, LZWOptions options){
+    /**
+     * Compresses a stream, such as std::cin, into a stream, such
+     * as std::cout, in the same format compress() writes
+     * The input is only read forward a block at a time, so pipes
+     * work and memory stays bounded however long the stream is
+     *
+     * @param in    Stream to compress
+     * @param out   Stream for the compressed bytes, flushed on return
+     * @param options   Compression settings
+     * @returns Statistics of the compression
+     * @throws invalid_argument if the settings are out of range
+     * @throws ofstream::failure if writing to out fails
+    */
+
+    BinaryFIn stream_in;
+    stream_in.initialize(in);
+    BinaryFOut stream_out;
+    stream_out.initialize(out);
+    return compress(stream_in, stream_out, options);
+}
+
+template<class Dict>
+LZWStats BasicLZW<Dict>::compress(BinaryFIn& in, BinaryFOut& out, const LZWOptions& options){
+    /**
+     * Private member to compress input read forward, from a file
+     * or a caller's stream, a block or a window at a time
+     *
+     * @param in    Input to compress
+     * @param out   Output for the whole compressed file, closed on return
+     * @param options   Compression settings
+     * @returns Statistics of the compression
+     * @throws invalid_argument if the settings are out of range
+    */
+
+    const LZWHeader h = header(options);
+    h.write(out);
+
+    LZWStats stats;
+    double reading = 0; // Time reading the input
+    if(h.flags & LZWHeader::BLOCKS){
+        compress_blocks<Dict>(thread_count(options.threads), h, options.effort, out,
+            [&](std::size_t, std::vector<unsigned char>& block){
+                LZWTimer timer(reading);
+                block.resize(h.block_size);
+                block.resize(in.read_bytes(reinterpret_cast<char*>(block.data()), block.size()));
+                return !block.empty();
+            },
+            [](std::size_t, const std::vector<unsigned char>& block){
+                return std::span<const unsigned char>(block);
+            },
+            [](std::size_t, const std::vector<unsigned char>&){
+            },
+            stats);
+    }
+    else{
+        BasicLZWEncoder<Dict> encoder(h, out, options.effort);
+        std::vector<unsigned char> window(WINDOW); // Bounded view of the input
+        auto read_window = [&](){
+            LZWTimer timer(reading);
+            return in.read_bytes(reinterpret_cast<char*>(window.data()), window.size());
+        };
+        std::size_t n;
+        while((n = read_window()) > 0){
+            encoder.encode(std::span<const unsigned char>(window.data(), n));
+        }
+        encoder.finish();
+        stats = encoder.statistics();
+        if(h.flags & LZWHeader::SYNC){
+            encoder.sync_index().write(out);
+            stats.parts = encoder.sync_index().parts.size();
         }
-        input = input.substr(t, input.length()-t);
     }
 
-    file_out.write(R, W);
-    file_out.close();
+    {
+        LZWTimer timer(stats.io_seconds);
+        out.close();
+    }
+    stats.io_seconds += reading;
+    stats.bytes_in = stats.raw_bytes;
+    stats.bytes_out = out.tell();
+    return stats;
 }
 
-void LZW::expand(){
+template<class Dict>
+LZWStats BasicLZW<Dict>::expand(){
     /**
      * Expands a compressed file using lossless
      * decompression algorithm
      * Assumes compressed file exists in directory as
      * "compress.lzw"
      * Outputs expanded file as "expanded.txt"
+     *
+     * @returns Statistics of the expansion
+     * @throws invalid_argument if the file is not a valid compressed file
+    */
+
+    BinaryFOut file_out;
+    file_out.initialize("expanded.txt", options.output_buffers);
+    return expand_file("compress.lzw", file_out);
+}
+
+template<class Dict>
+LZWStats BasicLZW<Dict>::expand(const std::string& output){
+    /**
+     * Expands the given file, itself a compressed file,
+     * into the file output
+     *
+     * @param output    Name of the expanded file to write
+     * @returns Statistics of the expansion
+     * @throws invalid_argument if the file is not a valid compressed file
+     * @throws ifstream::failure if either file cannot be opened
+     * @throws ofstream::failure if writing output fails
     */
 
-    /* Initialize file I/O objects */
-    BinaryFIn file_in;
-    file_in.initialize("compress.lzw");
     BinaryFOut file_out;
-    file_out.initialize("expanded.txt");
+    file_out.initialize(output, options.output_buffers);
+    if(!file_out.is_open()) throw(std::ofstream::failure("Cannot create " + output));
+    return expand_file(file, file_out);
+}
+
+template<class Dict>
+LZWStats BasicLZW<Dict>::expand(std::ostream& out){
+    /**
+     * Expands the given file, itself a compressed file,
+     * into a stream, such as std::cout
+     *
+     * @param out   Stream for the expanded bytes, flushed on return
+     * @returns Statistics of the expansion
+     * @throws invalid_argument if the file is not a valid compressed file
+     * @throws ifstream::failure if the file cannot be opened
+     * @throws ofstream::failure if writing to out fails
+    */
+
+    BinaryFOut stream_out;
+    stream_out.initialize(out);
+    return expand_file(file, stream_out);
+}
+
+template<class Dict>
+LZWStats BasicLZW<Dict>::expand_file(const std::string& input, BinaryFOut& out){
+    /**
+     * Private member to expand a compressed file
+     * Widths, dictionary mode and blocks are taken from the file header,
+     * and a trained dictionary from the settings
+     *
+     * @param input Name of the compressed file
+     * @param out   Output for the expanded file, closed on return
+     * @returns Statistics of the expansion
+     * @throws invalid_argument if input is not a valid compressed file
+     * @throws ifstream::failure if input cannot be opened
+    */
+
+    BinaryFIn file_in;
+    file_in.initialize(input);
+    if(!file_in.is_open()) throw(std::ifstream::failure("Cannot open " + input));
+    LZWHeader h = LZWHeader::read(file_in);
+    h.use(options.dictionary);
+
+    LZWStats stats = expand(file_in, h, out, options.threads);
+    stats.bytes_in = file_in.size();
+    return stats;
+}
+
+template<class Dict>
+LZWStats BasicLZW<Dict>::expand(std::istream& in, std::ostream& out, unsigned threads,
+    const LZWDictionary* dictionary){
+    /**
+     * Expands a stream, such as std::cin, holding the format
+     * compress() writes into a stream, such as std::cout
+     * A single codeword stream, with or without sync points, is
+     * expanded in order as it is read; blocks are
+     * found through the index at the end, which a stream cannot seek
+     * to, so a file of blocks is read into memory first
+     *
+     * @param in    Stream of compressed bytes
+     * @param out   Stream for the expanded bytes, flushed on return
+     * @param threads   Worker threads for blocks, 0 for one per core
+     * @param dictionary    Trained dictionary in was compressed with, nullptr for none
+     * @returns Statistics of the expansion
+     * @throws invalid_argument if in is not a valid compressed file
+     *  or needs a trained dictionary that was not given
+     * @throws ofstream::failure if writing to out fails
+    */
 
-    std::string st [L]; // Symbol table
-    int i; // Next available codeword value
+    BinaryFIn stream_in;
+    stream_in.initialize(in);
+    BinaryFOut stream_out;
+    stream_out.initialize(out);
+    LZWHeader h = LZWHeader::read(stream_in);
+    h.use(dictionary);
 
-    /* Initialize symbol table */
-    for(i=0; i<R; ++i){
-        st[i] = std::string(1, static_cast<char>(i));
+    if(!(h.flags & LZWHeader::BLOCKS)){
+        LZWStats stats = expand(stream_in, h, stream_out, threads);
+        stats.bytes_in += h.size();
+        return stats;
     }
-    st[i] = ""; // (unused) lookahead for EOF
-    i++;
 
-    int codeword = file_in.read_r(W);
-    if(codeword == R) return; // Empty message
+    std::vector<unsigned char> whole; // The whole compressed file, header included
+    BinaryFOut collect;
+    collect.initialize(whole);
+    h.write(collect);
+    std::vector<char> chunk(WINDOW);
+    std::size_t got;
+    while((got = stream_in.read_bytes(chunk.data(), chunk.size())) > 0) collect.write_bytes(chunk.data(), got);
+    collect.close();
+
+    BinaryFIn memory_in;
+    memory_in.initialize(std::span<const unsigned char>(whole));
+    LZWHeader::read(memory_in);
+    LZWStats stats = expand(memory_in, h, stream_out, threads);
+    stats.bytes_in = whole.size();
+    return stats;
+}
+
+template<class Dict>
+LZWStats BasicLZW<Dict>::expand(BinaryFIn& in, const LZWHeader& h, BinaryFOut& out, unsigned threads){
+    /**
+     * Private member to expand a compressed file whose header
+     * has been read
+     * Blocks, or the parts between sync points, are located through
+     * the index, expanded in parallel and written in order; a stream
+     * that cannot seek is expanded in order instead
+     *
+     * @param in    Compressed file positioned after the header,
+     *  which must be seekable if it holds blocks
+     * @param h Header read from in
+     * @param out   Output for the expanded file, closed on return
+     * @param threads   Worker threads for blocks, 0 for one per core
+     * @returns Statistics of the expansion; bytes_in counts only codewords
+     * @throws invalid_argument if in is not a valid compressed file
+    */
+
+    LZWStats stats;
+    if(h.flags & LZWHeader::BLOCKS){
+        expand_blocks(in, out, h, threads, stats);
+    }
+    else if((h.flags & LZWHeader::SYNC) && in.size() > 0){
+        expand_parts(in, out, h, threads, stats);
+    }
+    else{
+        LZWDecoder decoder(h);
+        decoder.decode(in, out);
+        stats = decoder.statistics();
+    }
+
+    {
+        LZWTimer timer(stats.io_seconds);
+        out.close();
+    }
+    stats.bytes_out = out.tell();
+    stats.raw_bytes = stats.bytes_out;
+    return stats;
+}
+
+template<class Dict>
+void BasicLZW<Dict>::expand_blocks(BinaryFIn& file_in, BinaryFOut& file_out, const LZWHeader& h, unsigned threads,
+    LZWStats& stats){
+    /**
+     * Private member to expand the blocks of a file
+     * Blocks are located through the index, expanded in
+     * parallel and written in order
+     *
+     * @param file_in   Compressed file, positioned after the header
+     * @param file_out  Output for the expanded file
+     * @param h Header read from file_in
+     * @param threads   Requested number of threads
+     * @param stats Statistics to add every block's counters to
+     * @throws invalid_argument if the file is not a valid compressed file
+    */
+
+    const LZWBlockIndex index = LZWBlockIndex::read(file_in, h);
+    std::mutex m; // Guards stats, added to by every worker
+    double io = 0; // Time reading and writing blocks, serialized by the pipeline
+
+    ordered_pipeline(thread_count(threads),
+        [&](std::size_t i, std::vector<unsigned char>& in){
+            LZWTimer timer(io);
+            if(i == index.blocks.size()) return false;
+            const LZWBlockIndex::Entry& e = index.blocks[i];
+            file_in.seek(e.offset);
+            in.resize(e.size);
+            if(file_in.read_bytes(reinterpret_cast<char*>(in.data()), in.size()) != in.size()){
+                throw(std::ifstream::failure("Compressed file ended inside a block"));
+            }
+            return true;
+        },
+        [&](std::size_t i, const std::vector<unsigned char>& in, std::vector<unsigned char>& out){
+            out.resize(index.blocks[i].raw_size);
+            const LZWStats s = expand_block(h, in, out);
+            std::lock_guard<std::mutex> lock(m);
+            stats.add(s);
+        },
+        [&](std::size_t, const std::vector<unsigned char>&, const std::vector<unsigned char>& out){
+            LZWTimer timer(io);
+            file_out.write_bytes(reinterpret_cast<const char*>(out.data()), out.size());
+        });
+
+    std::lock_guard<std::mutex> lock(m);
+    stats.io_seconds += io;
+    stats.blocks = index.blocks.size();
+}
+
+template<class Dict>
+void BasicLZW<Dict>::expand_parts(BinaryFIn& file_in, BinaryFOut& file_out, const LZWHeader& h, unsigned threads,
+    LZWStats& stats){
+    /**
+     * Private member to expand a stream with sync points
+     * Parts are located through the sync index and expanded
+     * in parallel, a run at a time, and written in order
+     *
+     * @param file_in   Compressed file, positioned after the header
+     * @param file_out  Output for the expanded file
+     * @param h Header read from file_in
+     * @param threads   Requested number of threads
+     * @param stats Statistics to add every part's counters to
+     * @throws invalid_argument if the file is not a valid compressed file
+    */
+
+    const LZWSyncIndex index = LZWSyncIndex::read(file_in, h);
+    const std::vector<std::size_t> runs = part_runs(index);
+    std::mutex m; // Guards stats, added to by every worker
+    double io = 0; // Time reading and writing parts, serialized by the pipeline
+
+    ordered_pipeline(thread_count(threads),
+        [&](std::size_t r, std::vector<unsigned char>& in){
+            LZWTimer timer(io);
+            if(r + 1 == runs.size()) return false;
+            const uint64_t from = index.parts[runs[r]].bit_offset / 8;
+            file_in.seek(from);
+            in.resize(part_end(index, runs[r+1] - 1) - from);
+            if(file_in.read_bytes(reinterpret_cast<char*>(in.data()), in.size()) != in.size()){
+                throw(std::ifstream::failure("Compressed file ended inside a part"));
+            }
+            return true;
+        },
+        [&](std::size_t r, const std::vector<unsigned char>& in, std::vector<unsigned char>& out){
+            BinaryFOut run_out;
+            run_out.initialize(out);
+            const LZWStats s = expand_run(h, index, runs[r], runs[r+1], in, run_out);
+            std::lock_guard<std::mutex> lock(m);
+            stats.add(s);
+        },
+        [&](std::size_t, const std::vector<unsigned char>&, const std::vector<unsigned char>& out){
+            LZWTimer timer(io);
+            file_out.write_bytes(reinterpret_cast<const char*>(out.data()), out.size());
+        });
+
+    std::lock_guard<std::mutex> lock(m);
+    stats.io_seconds += io;
+    stats.parts = index.parts.size();
+}
+
+template<class Dict>
+LZWStats BasicLZW<Dict>::compress(std::span<const unsigned char> data, BinaryFOut& out, const LZWOptions& options,
+    BinaryFIn* mapped){
+    /**
+     * Private member to compress bytes in memory
+     * Input is encoded straight from data, without copying
+     * When data is a file mapping, each part is released once
+     * encoded, so resident memory stays bounded however big the file
+     *
+     * @param data  Bytes to compress
+     * @param out   Output for the whole compressed file, closed on return
+     * @param options   Compression settings
+     * @param mapped    Input whose mapping data is, nullptr for other memory
+     * @returns Statistics of the compression
+     * @throws invalid_argument if the settings are out of range
+    */
 
-    std::string val = st[codeword]; 
+    const LZWHeader h = header(options);
+    h.write(out);
 
-    while(true){
-        if(file_in.get_eof()) break; // Break if at EOF
-        file_out.write(val);
-        codeword = file_in.read_r(W);
-        std::string s = st[codeword];
-        if (i == codeword) s = val + val.at(0); // Special case
-        if(i < L) st[i] = val + s.at(0);
-        i++;
-        val = s;
+    LZWStats stats;
+    if(h.flags & LZWHeader::BLOCKS){
+        auto view = [&](std::size_t i){
+            const std::size_t start = i * h.block_size;
+            return data.subspan(start, std::min<std::size_t>(h.block_size, data.size() - start));
+        };
+        compress_blocks<Dict>(thread_count(options.threads), h, options.effort, out,
+            [&](std::size_t i, std::vector<unsigned char>&){
+                return i < (data.size() + h.block_size - 1) / h.block_size;
+            },
+            [&](std::size_t i, const std::vector<unsigned char>&){
+                return view(i);
+            },
+            [&](std::size_t i, const std::vector<unsigned char>&){
+                if(mapped != nullptr) mapped->release(view(i));
+            },
+            stats);
     }
+    else{
+        BasicLZWEncoder<Dict> encoder(h, out, options.effort);
+        for(std::size_t start=0; start<data.size(); start+=WINDOW){
+            const std::span<const unsigned char> window = data.subspan(start, std::min<std::size_t>(data.size() - start, +WINDOW));
+            encoder.encode(window);
+            if(mapped != nullptr) mapped->release(window);
+        }
+        encoder.finish();
+        stats = encoder.statistics();
+        if(h.flags & LZWHeader::SYNC){
+            encoder.sync_index().write(out);
+            stats.parts = encoder.sync_index().parts.size();
+        }
+    }
+
+    {
+        LZWTimer timer(stats.io_seconds);
+        out.close();
+    }
+    stats.bytes_in = data.size();
+    stats.raw_bytes = data.size();
+    stats.bytes_out = out.tell();
+    return stats;
+}
+
+template<class Dict>
+std::vector<std::byte> BasicLZW<Dict>::compress(std::span<const std::byte> data, LZWOptions options){
+    /**
+     * Compresses bytes in memory into the same format compress() writes
+     *
+     * @param data  Bytes to compress
+     * @param options   Compression settings
+     * @returns Compressed bytes
+     * @throws invalid_argument if the settings are out of range
+    */
+
+    std::vector<std::byte> compressed;
+    BinaryFOut out;
+    out.initialize(compressed);
+    compress(std::span<const unsigned char>(reinterpret_cast<const unsigned char*>(data.data()), data.size()), out, options);
+    return compressed;
+}
+
+template<class Dict>
+std::size_t BasicLZW<Dict>::compress(std::span<const std::byte> data, std::span<std::byte> out, LZWOptions options){
+    /**
+     * Compresses bytes in memory into a caller's buffer
+     * A buffer of compress_bound(data.size(), options) bytes is always enough
+     *
+     * @param data  Bytes to compress
+     * @param out   Buffer for the compressed bytes
+     * @param options   Compression settings
+     * @returns Number of bytes of out used
+     * @throws invalid_argument if the settings are out of range or out is too small
+    */
+
+    BinaryFOut bytes_out;
+    bytes_out.initialize(std::span<unsigned char>(reinterpret_cast<unsigned char*>(out.data()), out.size()));
+    compress(std::span<const unsigned char>(reinterpret_cast<const unsigned char*>(data.data()), data.size()), bytes_out, options);
+    return bytes_out.tell();
+}
+
+template<class Dict>
+std::size_t BasicLZW<Dict>::compress_bound(std::size_t size, LZWOptions options){
+    /**
+     * Bounds the compressed size of any size bytes
+     * In the worst case every byte is its own codeword of max_width bits,
+     * plus a CLEAR each time the dictionary fills or at a sync point and
+     * the EOF codeword, for every block, plus the header and any index
+     * A Huffman coded codeword takes up to MAX_LENGTH - BIN_BITS bits
+     * more, and each block its code lengths
+     *
+     * @param size  Number of bytes to compress
+     * @param options   Compression settings
+     * @returns Largest number of bytes compress() can produce
+     * @throws invalid_argument if the settings are out of range
+    */
+
+    const LZWHeader h = header(options);
+    const std::size_t entries = (std::size_t(1) << h.max_width) - h.start_code(); // Codewords between CLEARs
+    const bool huffman = h.flags & LZWHeader::HUFFMAN;
+    const std::size_t bits = h.max_width + (huffman ? LZWEntropy::MAX_LENGTH - LZWEntropy::BIN_BITS : 0); // Per codeword
+    auto stream = [&](std::size_t n){
+        const std::size_t codes = n + n / entries + 2;
+        return (codes * bits + 7) / 8 + (huffman ? LZWEntropy::TABLE_SIZE : 0);
+    };
+
+    const std::size_t header_size = h.size();
+    if(h.flags & LZWHeader::SYNC){
+        const std::size_t syncs = size / h.sync_interval; // Every part before a sync point holds sync_interval codewords
+        return header_size + stream(size) + (syncs * h.max_width + 7) / 8
+            + (syncs + 1) * 2 * sizeof(uint64_t) + LZWSyncIndex::TRAILER_SIZE;
+    }
+    if(!(h.flags & LZWHeader::BLOCKS)) return header_size + stream(size);
+
+    const std::size_t full = size / h.block_size; // Number of whole blocks
+    const std::size_t rest = size % h.block_size; // Bytes in the last, partial block
+    const std::size_t blocks = full + (rest > 0 ? 1 : 0);
+    return header_size + full * stream(h.block_size) + (rest > 0 ? stream(rest) : 0)
+        + blocks * 3 * sizeof(uint64_t) + LZWBlockIndex::TRAILER_SIZE;
+}
+
+template<class Dict>
+void BasicLZW<Dict>::expand_blocks(std::span<const unsigned char> data, const LZWHeader& h,
+    const LZWBlockIndex& index, std::span<unsigned char> out, unsigned threads){
+    /**
+     * Private member to expand the blocks of a file in memory
+     * Each block is decoded in parallel straight from data into
+     * its own part of out, without copying
+     *
+     * @param data  The whole compressed file
+     * @param h Header read from data
+     * @param index Index of every block in data
+     * @param out   Buffer exactly the size of the expanded file
+     * @param threads   Requested number of threads
+     * @throws invalid_argument if a block does not expand to its recorded size
+    */
+
+    std::vector<std::size_t> starts(index.blocks.size()); // Position of each block in out
+    for(std::size_t i=1; i<starts.size(); ++i){
+        starts[i] = starts[i-1] + index.blocks[i-1].raw_size;
+    }
+
+    ordered_pipeline(thread_count(threads),
+        [&](std::size_t i, std::vector<unsigned char>&){
+            return i < index.blocks.size();
+        },
+        [&](std::size_t i, const std::vector<unsigned char>&, std::vector<unsigned char>&){
+            const LZWBlockIndex::Entry& e = index.blocks[i];
+            expand_block(h, data.subspan(e.offset, e.size), out.subspan(starts[i], e.raw_size));
+        },
+        [](std::size_t, const std::vector<unsigned char>&, const std::vector<unsigned char>&){
+        });
+}
+
+template<class Dict>
+void BasicLZW<Dict>::expand_parts(std::span<const unsigned char> data, const LZWHeader& h,
+    const LZWSyncIndex& index, std::span<unsigned char> out, unsigned threads){
+    /**
+     * Private member to expand a stream with sync points in memory
+     * Runs of parts are decoded in parallel straight from data
+     * into their own places in out, without copying
+     *
+     * @param data  The whole compressed file
+     * @param h Header read from data
+     * @param index Index of every part in data
+     * @param out   Buffer exactly the size of the expanded file
+     * @param threads   Requested number of threads
+     * @throws invalid_argument if a part does not expand to its recorded size
+    */
+
+    const std::vector<std::size_t> runs = part_runs(index);
+    std::vector<std::size_t> starts(runs.size()); // Position of each run in out
+    for(std::size_t r=0; r+1<runs.size(); ++r){
+        starts[r+1] = starts[r];
+        for(std::size_t i=runs[r]; i<runs[r+1]; ++i) starts[r+1] += index.parts[i].raw_size;
+    }
+
+    ordered_pipeline(thread_count(threads),
+        [&](std::size_t r, std::vector<unsigned char>&){
+            return r + 1 < runs.size();
+        },
+        [&](std::size_t r, const std::vector<unsigned char>&, std::vector<unsigned char>&){
+            const std::size_t from = index.parts[runs[r]].bit_offset / 8;
+            BinaryFOut run_out;
+            run_out.initialize(out.subspan(starts[r], starts[r+1] - starts[r]));
+            expand_run(h, index, runs[r], runs[r+1], data.subspan(from, part_end(index, runs[r+1] - 1) - from), run_out);
+        },
+        [](std::size_t, const std::vector<unsigned char>&, const std::vector<unsigned char>&){
+        });
+}
+
+template<class Dict>
+std::vector<std::byte> BasicLZW<Dict>::expand(std::span<const std::byte> data, unsigned threads,
+    const LZWDictionary* dictionary){
+    /**
+     * Expands bytes in memory holding the format compress() writes
+     *
+     * @param data  Compressed bytes
+     * @param threads   Worker threads for blocks, 0 for one per core
+     * @param dictionary    Trained dictionary data was compressed with, nullptr for none
+     * @returns Expanded bytes
+     * @throws invalid_argument if data is not a valid compressed file
+     *  or needs a trained dictionary that was not given
+    */
+
+    const std::span<const unsigned char> bytes(reinterpret_cast<const unsigned char*>(data.data()), data.size());
+    BinaryFIn in;
+    in.initialize(bytes);
+    LZWHeader h = LZWHeader::read(in);
+    h.use(dictionary);
+
+    std::vector<std::byte> expanded;
+    if(h.flags & LZWHeader::BLOCKS){
+        const LZWBlockIndex index = LZWBlockIndex::read(in, h);
+        expanded.resize(raw_total(index.blocks, expanded.max_size(), h.max_expansion(bytes.size())));
+        expand_blocks(bytes, h, index,
+            std::span<unsigned char>(reinterpret_cast<unsigned char*>(expanded.data()), expanded.size()), threads);
+        return expanded;
+    }
+    if(h.flags & LZWHeader::SYNC){
+        const LZWSyncIndex index = LZWSyncIndex::read(in, h);
+        expanded.resize(raw_total(index.parts, expanded.max_size(), h.max_expansion(bytes.size())));
+        expand_parts(bytes, h, index,
+            std::span<unsigned char>(reinterpret_cast<unsigned char*>(expanded.data()), expanded.size()), threads);
+        return expanded;
+    }
+
+    BinaryFOut out;
+    out.initialize(expanded);
+    LZWDecoder decoder(h);
+    decoder.decode(in, out);
+    out.close();
+    return expanded;
+}
+
+template<class Dict>
+std::size_t BasicLZW<Dict>::expand(std::span<const std::byte> data, std::span<std::byte> out, unsigned threads,
+    const LZWDictionary* dictionary){
+    /**
+     * Expands bytes in memory into a caller's buffer
+     *
+     * @param data  Compressed bytes
+     * @param out   Buffer for the expanded bytes
+     * @param threads   Worker threads for blocks, 0 for one per core
+     * @param dictionary    Trained dictionary data was compressed with, nullptr for none
+     * @returns Number of bytes of out used
+     * @throws invalid_argument if data is not a valid compressed file, needs
+     *  a trained dictionary that was not given, or out is too small
+    */
+
+    const std::span<const unsigned char> bytes(reinterpret_cast<const unsigned char*>(data.data()), data.size());
+    const std::span<unsigned char> region(reinterpret_cast<unsigned char*>(out.data()), out.size());
+    BinaryFIn in;
+    in.initialize(bytes);
+    LZWHeader h = LZWHeader::read(in);
+    h.use(dictionary);
+
+    if(h.flags & LZWHeader::BLOCKS){
+        const LZWBlockIndex index = LZWBlockIndex::read(in, h);
+        const std::size_t total = raw_total(index.blocks, region.size(), h.max_expansion(bytes.size()));
+        expand_blocks(bytes, h, index, region.first(total), threads);
+        return total;
+    }
+    if(h.flags & LZWHeader::SYNC){
+        const LZWSyncIndex index = LZWSyncIndex::read(in, h);
+        const std::size_t total = raw_total(index.parts, region.size(), h.max_expansion(bytes.size()));
+        expand_parts(bytes, h, index, region.first(total), threads);
+        return total;
+    }
+
+    BinaryFOut bytes_out;
+    bytes_out.initialize(region);
+    LZWDecoder decoder(h);
+    decoder.decode(in, bytes_out);
+    bytes_out.close();
+    return bytes_out.tell();
+}
+
+template<class Dict>
+std::string BasicLZW<Dict>::expand_range(std::size_t offset, std::size_t length){
+    /**
+     * Expands only a range of the original file from the given file,
+     * itself a compressed file
+     * Every block but the last holds exactly block_size bytes, so the
+     * blocks covering the range are found by division and their index
+     * entries read directly; only those blocks are decoded, each
+     * stopping once it reaches the end of the range
+     * The cost depends on the block size and the range, not the file size
+     *
+     * @param offset    Position of the first byte wanted in the original file
+     * @param length    Number of bytes wanted
+     * @returns Bytes offset to offset+length-1, cut short at the end of the file
+     * @throws invalid_argument if the file was not compressed in blocks
+     *  or is not a valid compressed file
+     * @throws ifstream::failure if the file cannot be opened
+    */
+
+    /* Initialize file I/O objects */
+    BinaryFIn file_in;
+    file_in.initialize(file);
+    if(!file_in.is_open()) throw(std::ifstream::failure("Cannot open " + file));
+
+    LZWHeader h = LZWHeader::read(file_in);
+    h.use(options.dictionary);
+    if(!(h.flags & LZWHeader::BLOCKS)){
+        throw(std::invalid_argument("Ranges can only be expanded from a file compressed in blocks"));
+    }
+
+    std::string range;
+    length = std::min(length, std::numeric_limits<std::size_t>::max() - offset);
+    if(length == 0) return range;
+
+    const std::size_t end = offset + length; // Position just past the last byte wanted
+    const std::size_t first = offset / h.block_size;
+    const LZWBlockIndex index = LZWBlockIndex::read(file_in, h, first, (end - 1) / h.block_size - first + 1);
+
+    ordered_pipeline(std::min<std::size_t>(thread_count(options.threads), index.blocks.size()),
+        [&](std::size_t i, std::vector<unsigned char>& in){
+            if(i == index.blocks.size()) return false;
+            const LZWBlockIndex::Entry& e = index.blocks[i];
+            if(index.first + i + 1 < index.total && e.raw_size != h.block_size){
+                throw(std::invalid_argument("Corrupt block index"));
+            }
+            file_in.seek(e.offset);
+            in.resize(e.size);
+            if(file_in.read_bytes(reinterpret_cast<char*>(in.data()), in.size()) != in.size()){
+                throw(std::ifstream::failure("Compressed file ended inside a block"));
+            }
+            return true;
+        },
+        [&](std::size_t i, const std::vector<unsigned char>& in, std::vector<unsigned char>& out){
+            const std::size_t start = (first + i) * h.block_size; // Position of the block in the original file
+            const std::size_t want = std::min<std::size_t>(index.blocks[i].raw_size, end - start);
+            out.reserve(want);
+            BinaryFIn block_in;
+            block_in.initialize(in);
+            BinaryFOut block_out;
+            block_out.initialize(out);
+            LZWDecoder decoder(h);
+            decoder.decode(block_in, block_out, want);
+            block_out.close();
+            if(out.size() < want || out.size() > index.blocks[i].raw_size){
+                throw(std::invalid_argument("Corrupt compressed file"));
+            }
+        },
+        [&](std::size_t i, const std::vector<unsigned char>&, const std::vector<unsigned char>& out){
+            const std::size_t start = (first + i) * h.block_size;
+            const std::size_t from = std::max(offset, start) - start;
+            const std::size_t to = std::min(out.size(), end - start);
+            if(from < to) range.append(reinterpret_cast<const char*>(out.data()) + from, to - from);
+        });
+
+    return range;
+}
 
-    file_out.close();
-}
\ No newline at end of file
+/* Dictionaries LZW can be built with */
+template class BasicLZW<ArenaDLB>;
+template class BasicLZW<HashDict>;
+template class BasicLZW<SimdDLB>;
+template class BasicLZW<PoolDLB>;
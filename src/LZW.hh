@@ -2,19 +2,99 @@
 #define LZW_COMP
 
 #include <string>
+#include <iostream>
+#include <vector>
+#include <span>
+#include <cstddef>
 
-class LZW{
+#include "LZWHeader.hh"
+#include "LZWStats.hh"
+#include "LZWDictionary.hh"
+#include "ArenaDLB.hh"
+#include "HashDict.hh"
+#include "SimdDLB.hh"
+#include "PoolDLB.hh"
+
+struct LZWOptions{
+    /**
+     * Settings for compression
+     * Everything expansion needs is recorded in the file header
+    */
+
+    int min_width = 9; // Codeword width to start at
+    int max_width = 16; // Codeword width to grow up to (min_width == max_width for fixed width)
+    bool reset = true; // Reset the dictionary when it fills, otherwise keep it frozen
+    std::size_t block_size = 1 << 20; // Bytes per independently compressed block, 0 for one stream
+    std::size_t sync_interval = 0; // Codewords between sync points in one stream, 0 for none
+    unsigned threads = 0; // Worker threads for blocks or parts between sync points, 0 for one per core
+    unsigned output_buffers = 2; // Blocks of file output in flight, 1 writes on the calling thread
+    const LZWDictionary* dictionary = nullptr; // Trained dictionary to start from, nullptr for none; expansion needs it too
+    bool huffman = false; // Huffman code each block's codewords, for a better ratio (needs block_size > 0)
+    int effort = 0; // Shorter matches tried at each codeword, 0 to 16, for a better ratio at a slower compression
+};
+
+template<class Dict>
+class BasicLZW{
     private:
-        const int R = 256; // Number of input characters
-        const int L = 4096; // Number of codewords (2^W)
-        const int W = 12; // Codeword width
+        static const std::size_t WINDOW = 1 << 16; // Bytes of input encoded at a time while compressing one stream
         std::string file;
+        LZWOptions options;
+        static unsigned thread_count(unsigned threads); // Number of worker threads to use
+        static LZWStats compress(std::span<const unsigned char> data, BinaryFOut& out, const LZWOptions& options,
+            BinaryFIn* mapped = nullptr);
+        static LZWStats compress(BinaryFIn& in, BinaryFOut& out, const LZWOptions& options);
+        LZWStats compress_file(BinaryFOut& out);
+        LZWStats expand_file(const std::string& input, BinaryFOut& out);
+        static LZWStats expand(BinaryFIn& in, const LZWHeader& header, BinaryFOut& out, unsigned threads);
+        static void expand_blocks(BinaryFIn& file_in, BinaryFOut& file_out, const LZWHeader& header, unsigned threads,
+            LZWStats& stats);
+        static void expand_blocks(std::span<const unsigned char> data, const LZWHeader& header,
+            const LZWBlockIndex& index, std::span<unsigned char> out, unsigned threads);
+        static void expand_parts(BinaryFIn& file_in, BinaryFOut& file_out, const LZWHeader& header, unsigned threads,
+            LZWStats& stats);
+        static void expand_parts(std::span<const unsigned char> data, const LZWHeader& header,
+            const LZWSyncIndex& index, std::span<unsigned char> out, unsigned threads);
 
     public:
-        LZW() = delete; // Prevent default constructor
-        LZW(std::string file_name); // Constructor with file to compress specified
-        void compress();
-        void expand();
+        BasicLZW() = delete; // Prevent default constructor
+        BasicLZW(std::string file_name); // Constructor with file to compress specified
+        BasicLZW(std::string file_name, LZWOptions options); // Constructor with compression settings
+        static LZWHeader header(const LZWOptions& options); // Header describing the compression settings
+        LZWStats compress(); // Compress the file into compress.lzw
+        LZWStats expand(); // Expand compress.lzw into expanded.txt
+        LZWStats compress(const std::string& output); // Compress the file into output
+        LZWStats expand(const std::string& output); // Expand the file, itself compressed, into output
+        LZWStats compress(std::ostream& out); // Compress the file into a stream
+        LZWStats expand(std::ostream& out); // Expand the file, itself compressed, into a stream
+        std::string expand_range(std::size_t offset, std::size_t length); // Expand only bytes offset to offset+length-1 of the file, itself compressed
+
+        /* Between streams, such as std::cin and std::cout */
+        static LZWStats compress(std::istream& in, std::ostream& out, LZWOptions options = LZWOptions());
+        static LZWStats expand(std::istream& in, std::ostream& out, unsigned threads = 0,
+            const LZWDictionary* dictionary = nullptr);
+
+        /* In memory, without touching any file */
+        static std::vector<std::byte> compress(std::span<const std::byte> data, LZWOptions options = LZWOptions());
+        static std::size_t compress(std::span<const std::byte> data, std::span<std::byte> out,
+            LZWOptions options = LZWOptions()); // Compress into out, returns bytes used
+        static std::size_t compress_bound(std::size_t size, LZWOptions options = LZWOptions()); // Largest compressed size of size bytes
+        static std::vector<std::byte> expand(std::span<const std::byte> data, unsigned threads = 0,
+            const LZWDictionary* dictionary = nullptr);
+        static std::size_t expand(std::span<const std::byte> data, std::span<std::byte> out,
+            unsigned threads = 0, const LZWDictionary* dictionary = nullptr); // Expand into out, returns bytes used
 };
 
-#endif
\ No newline at end of file
+/**
+ * Dict is the dictionary the encoder looks strings up in:
+ * ArenaDLB (a trie with linked siblings), HashDict (a hash table on
+ * prefix codeword and next byte), SimdDLB (a trie with packed,
+ * vector-searched children) or PoolDLB (a trie of 8-byte nodes in a
+ * pool allocated once); all write the same files
+ * All are compiled in LZW.cpp
+*/
+using LZW = BasicLZW<ArenaDLB>;
+using HashLZW = BasicLZW<HashDict>;
+using SimdLZW = BasicLZW<SimdDLB>;
+using PoolLZW = BasicLZW<PoolDLB>;
+
+#endif
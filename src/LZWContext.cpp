@@ -0,0 +1,148 @@
+/**
+ * Implementation of reusable LZW contexts
+ *
+ * Compressing or expanding a message with LZW::compress and
+ * LZW::expand sizes a symbol table for every codeword, allocates
+ * bit I/O blocks and inserts the single characters, which for a
+ * message of a few KiB costs more than coding it
+ * A context does that once: between messages the encoder restarts
+ * on the same symbol table, whose clear() is O(1), and the decoder
+ * only resets its counters, since entries past the next codeword
+ * are never read
+ *
+ * Messages are ordinary single stream files, so either side
+ * can be LZW::compress or LZW::expand instead
+ *
+ * DEPENDENCIES:
+ *  BinaryFIn
+ *  BinaryFOut
+ *  LZWHeader
+ *  LZWEncoder
+ *  LZWDecoder
+ *  LZWStats
+ *  LZW
+*/
+
+#include <stdexcept>
+
+#include "LZWContext.hh"
+
+static LZWHeader message_header(LZWOptions options){
+    /**
+     * @param options   Compression settings
+     * @returns Header for one codeword stream with those settings
+     * @throws invalid_argument if the settings are out of range
+    */
+
+    options.block_size = 0;
+    options.sync_interval = 0;
+    options.huffman = false;
+    return LZW::header(options);
+}
+
+static bool same_stream(const LZWHeader& a, const LZWHeader& b){
+    /**
+     * @param a First header
+     * @param b Second header
+     * @returns Whether a decoder built for a decodes streams written under b
+    */
+
+    return a.flags == b.flags && a.min_width == b.min_width && a.max_width == b.max_width
+        && a.sync_interval == b.sync_interval && a.dictionary == b.dictionary;
+}
+
+template<class Dict>
+BasicLZWContext<Dict>::BasicLZWContext() : BasicLZWContext(LZWOptions()){
+}
+
+template<class Dict>
+BasicLZWContext<Dict>::BasicLZWContext(LZWOptions options)
+    : options(options), header(message_header(options)), encoder(header, sink, options.effort){
+    /**
+     * Constructor with compression settings
+     * Expansion takes its mode from each message's header, and the
+     * trained dictionary, if any, from the settings
+     *
+     * @param options   Codeword widths, what to do when the dictionary fills
+     *  and any trained dictionary, which must outlive the context
+     * @throws invalid_argument if the settings are out of range
+    */
+}
+
+template<class Dict>
+std::span<const std::byte> BasicLZWContext<Dict>::compress(std::span<const std::byte> data){
+    /**
+     * Compresses one message into the format LZW::compress writes
+     * with a block size of 0
+     *
+     * @param data  Bytes of the message
+     * @returns Compressed message, valid until the next call
+    */
+
+    buffer.clear();
+    sink.initialize(buffer);
+    header.write(sink);
+    encoder.restart();
+    encoder.encode(std::span<const unsigned char>(reinterpret_cast<const unsigned char*>(data.data()), data.size()));
+    encoder.finish();
+    stats = encoder.statistics();
+    {
+        LZWTimer timer(stats.io_seconds);
+        sink.close();
+    }
+    stats.bytes_in = data.size();
+    stats.raw_bytes = data.size();
+    stats.bytes_out = buffer.size();
+    return buffer;
+}
+
+template<class Dict>
+std::span<const std::byte> BasicLZWContext<Dict>::expand(std::span<const std::byte> data){
+    /**
+     * Expands one message holding a single codeword stream,
+     * with or without sync points
+     *
+     * @param data  Compressed message
+     * @returns Expanded message, valid until the next call
+     * @throws invalid_argument if data is not a valid compressed file,
+     *  holds blocks, or needs a trained dictionary the context was not given
+     * @throws ifstream::failure if data ends before the EOF codeword
+    */
+
+    source.initialize(std::span<const unsigned char>(reinterpret_cast<const unsigned char*>(data.data()), data.size()));
+    LZWHeader h = LZWHeader::read(source);
+    h.use(options.dictionary);
+    if(h.flags & LZWHeader::BLOCKS){
+        throw(std::invalid_argument("Contexts cannot expand blocks, use LZW::expand"));
+    }
+    if(!decoder || !same_stream(h, decoding)){
+        decoder.emplace(h);
+        decoding = h;
+    }
+
+    buffer.clear();
+    sink.initialize(buffer);
+    decoder->decode(source, sink);
+    sink.close();
+
+    stats = decoder->statistics();
+    stats.bytes_in = data.size();
+    stats.bytes_out = buffer.size();
+    stats.raw_bytes = buffer.size();
+    return buffer;
+}
+
+template<class Dict>
+LZWStats BasicLZWContext<Dict>::statistics(){
+    /**
+     * @returns Counters for the latest compress() or expand()
+    */
+
+    return stats;
+}
+
+/* Dictionaries LZW can be built with */
+template class BasicLZWContext<ArenaDLB>;
+template class BasicLZWContext<HashDict>;
+template class BasicLZWContext<SimdDLB>;
+template class BasicLZWContext<PoolDLB>;
@@ -0,0 +1,55 @@
+#ifndef LZW_CONTEXT
+#define LZW_CONTEXT
+
+#include <vector>
+#include <span>
+#include <optional>
+#include <cstddef>
+
+#include "BinaryFIn.hh"
+#include "BinaryFOut.hh"
+#include "LZWHeader.hh"
+#include "LZWEncoder.hh"
+#include "LZWDecoder.hh"
+#include "LZWStats.hh"
+#include "LZW.hh"
+
+template<class Dict>
+class BasicLZWContext{
+    /**
+     * Reusable state for compressing and expanding many small
+     * messages, each a complete single stream file
+     * Owns the symbol tables, bit I/O and output buffer, so after
+     * the first message of a given size nothing is allocated and
+     * the dictionaries are reset rather than built
+     * A context is not shared between threads; keep one per thread
+    */
+
+    private:
+        LZWOptions options; // Compression settings, always one stream
+        LZWHeader header; // Header written at the start of every compressed message
+        std::vector<std::byte> buffer; // Output of the latest call
+        BinaryFOut sink; // Writes into buffer
+        BinaryFIn source; // Reads the message being expanded
+        BasicLZWEncoder<Dict> encoder; // Bound to sink, restarted for every message
+        std::optional<LZWDecoder> decoder; // Built for the first message expanded, and again if the mode changes
+        LZWHeader decoding; // Header decoder was built for
+        LZWStats stats; // Counters for the latest call
+
+    public:
+        BasicLZWContext(); // Context with the default settings
+        BasicLZWContext(LZWOptions options); // Context with compression settings (block_size, sync_interval and huffman are ignored)
+        BasicLZWContext(const BasicLZWContext&) = delete;
+        BasicLZWContext& operator=(const BasicLZWContext&) = delete;
+        std::span<const std::byte> compress(std::span<const std::byte> data); // Compress one message
+        std::span<const std::byte> expand(std::span<const std::byte> data); // Expand one message
+        LZWStats statistics(); // Counters for the latest call
+};
+
+/* Contexts for each dictionary, compiled in LZWContext.cpp */
+using LZWContext = BasicLZWContext<ArenaDLB>;
+using HashLZWContext = BasicLZWContext<HashDict>;
+using SimdLZWContext = BasicLZWContext<SimdDLB>;
+using PoolLZWContext = BasicLZWContext<PoolDLB>;
+
+#endif
@@ -0,0 +1,547 @@
+/**
+ * Implementation of the LZW codeword decoder
+ *
+ * Reads one codeword stream, as written by LZWEncoder,
+ * and writes the expanded bytes
+ * Tracks the width and dictionary resets exactly as
+ * the encoder did, using the mode from the header
+ * With sync points the codeword after every sync_interval
+ * codewords for strings must be a CLEAR (or EOF), so a part
+ * of the stream can also be decoded on its own
+ * A trained dictionary's entries are copied into the symbol table
+ * once; later entries go after them, so a reset never touches them
+ * Huffman coded codewords are read one at a time, since each is
+ * coded against the number of codewords valid in its place
+ *
+ * A whole block in memory takes a faster path: every entry's string
+ * is already in the output, where its prefix was expanded, so the
+ * entry is a pointer and a length and expanding it is a copy of 16
+ * bytes at a time rather than a walk through its prefixes; copies
+ * may spill up to SLACK bytes past the string, which the next string
+ * overwrites, and only the last few strings of the block, with no
+ * room for that, are copied exactly
+ * Codewords are cut from a 64-bit window, loaded once for several,
+ * with no end of input checks other than on the bit position; fixed
+ * 12 and 16-bit streams have loops of their own with the width folded in
+ *
+ * DEPENDENCIES:
+ *  BinaryFIn
+ *  BinaryFOut
+ *  LZWHeader
+ *  LZWDictionary
+ *  LZWEntropy
+ *  LZWStats
+*/
+
+#include <stdexcept>
+#include <algorithm>
+#include <span>
+#include <bit>
+#include <cstring>
+
+#include "LZWDictionary.hh"
+#include "LZWDecoder.hh"
+
+LZWDecoder::LZWDecoder(const LZWHeader& header) : header(header){
+    /**
+     * Constructor with the mode to decode with
+     * Allocates everything decode needs up front
+     *
+     * @param header    Widths and dictionary mode
+     * @throws invalid_argument if the header's widths are out of range,
+     *  or it needs a trained dictionary that is not attached
+    */
+
+    header.validate();
+    first = header.start_code();
+    first_width = header.start_width();
+    const std::size_t L = std::size_t(1) << header.max_width;
+    prefix.resize(L);
+    last.resize(L);
+    length.resize(L);
+    origin.resize(L);
+    codes.resize(BATCH);
+    bytes.resize(OUT + L); // A string is at most one byte longer than the number of entries before it
+
+    /* Initialize symbol table */
+    for(int j=0; j<LZWHeader::R; ++j){
+        last[j] = static_cast<unsigned char>(j);
+        length[j] = 1;
+    }
+    if(header.dictionary != nullptr){
+        const std::span<const uint32_t> prefixes = header.dictionary->prefixes();
+        const std::span<const unsigned char> lasts = header.dictionary->lasts();
+        for(std::size_t j=0; j<prefixes.size(); ++j){
+            const std::size_t code = LZWHeader::FIRST + j;
+            prefix[code] = prefixes[j];
+            last[code] = lasts[j];
+            length[code] = length[prefixes[j]] + 1;
+        }
+    }
+
+    /* The block decoder copies the single characters and trained entries out of strings */
+    std::vector<std::size_t> at(first); // Position of each fixed entry's string in strings
+    for(int j=0; j<LZWHeader::R; ++j){
+        at[j] = strings.size();
+        strings.push_back(static_cast<unsigned char>(j));
+    }
+    for(int code=LZWHeader::FIRST; code<first; ++code){
+        at[code] = strings.size();
+        const std::size_t from = at[prefix[code]];
+        for(uint32_t j=0; j+1<length[code]; ++j) strings.push_back(strings[from + j]);
+        strings.push_back(last[code]);
+    }
+    strings.resize(strings.size() + SLACK);
+    for(int j=0; j<first; ++j){
+        if(j < LZWHeader::R || j >= LZWHeader::FIRST) origin[j] = strings.data() + at[j];
+    }
+    start();
+}
+
+void LZWDecoder::start(){
+    /**
+     * Prepares to decode a new codeword stream from the
+     * single character dictionary and the narrowest width
+     * The same state begins each part after a sync point
+    */
+
+    used = 0;
+    k = 0;
+    got = 0;
+    i = first;
+    width = first_width;
+    prev = -1;
+    since_sync = 0;
+    head = 0;
+    ended = false;
+    bits = 0;
+    entropy.reset();
+    stats = LZWStats();
+}
+
+bool LZWDecoder::done(){
+    /**
+     * @returns Whether the stream's EOF codeword has been decoded
+    */
+
+    return ended;
+}
+
+uint64_t LZWDecoder::bits_read(){
+    /**
+     * @returns Number of bits of codewords taken from input since start(),
+     *  including any read but not yet decoded; once the EOF codeword
+     *  has been decoded, exactly the bits up to its end
+    */
+
+    return bits;
+}
+
+LZWStats LZWDecoder::statistics(){
+    /**
+     * @returns Counters since start(); bytes_in counts whole bytes
+     *  of codewords read
+    */
+
+    LZWStats s = stats;
+    s.bytes_in = (bits + 7) / 8;
+    return s;
+}
+
+unsigned char LZWDecoder::expand(int c){
+    /**
+     * Private member to add the string of codeword c after the
+     * bytes waiting in bytes, walking back through its prefixes
+     * so it is filled from the end
+     *
+     * @param c Codeword in the dictionary
+     * @returns First byte of the string
+    */
+
+    const uint32_t n = length[c];
+    unsigned char* p = bytes.data() + used + n;
+    for(uint32_t j=n; j>1; --j){
+        *--p = last[c];
+        c = prefix[c];
+    }
+    *--p = last[c];
+    used += n;
+    return *p;
+}
+
+bool LZWDecoder::resume(BinaryFIn& in, BinaryFOut& out, std::size_t limit){
+    /**
+     * Continues the stream started by start(), decoding codewords
+     * until its EOF codeword, until out holds at least limit bytes,
+     * or until in has no whole codeword left
+     * In the last case every state, including codewords read but
+     * not decoded, is kept, so the stream can be resumed with
+     * an input holding the bits that follow
+     *
+     * Each entry is stored as the codeword of its prefix plus its last
+     * byte, so adding one is constant time, and it is expanded by
+     * walking back through its prefixes; nothing is allocated
+     *
+     * @param in    Input positioned at the next codeword
+     * @param out   Output for the expanded bytes, all written on return
+     * @param limit Number of bytes of out (counted by out.tell()) after
+     *  which the rest of the stream is not needed
+     * @returns false if in ran out before the EOF codeword or the limit
+     * @throws invalid_argument if the codewords are not a valid stream
+     * @throws ifstream::failure if in ends inside a Huffman coded stream,
+     *  which is only ever decoded from a whole block
+    */
+
+    const int R = LZWHeader::R;
+    const bool reset = header.flags & LZWHeader::RESET;
+    const int L = 1 << header.max_width; // Number of codewords
+    const uint32_t sync = header.sync_interval; // Codewords for strings between sync points, 0 for none
+    std::size_t told = out.tell(); // Bytes in out before the waiting ones
+    LZWTimer timer(stats.dictionary_seconds);
+
+    /* Decoded strings are collected in bytes and written OUT at a time */
+    auto flush_bytes = [&](){
+        LZWTimer io(stats.io_seconds, &stats.dictionary_seconds);
+        out.write_bytes(reinterpret_cast<const char*>(bytes.data()), used);
+        told += used;
+        stats.raw_bytes += used;
+        stats.bytes_out += used;
+        used = 0;
+    };
+
+    while(!ended){
+        if(used >= OUT) flush_bytes();
+        if(told + used >= limit) break;
+
+        /**
+         * Codewords are read up to BATCH at a time and handed out one by one
+         * A batch never crosses a point where the width could change:
+         * each codeword adds at most one entry, so the next (1 << width) - i
+         * are all the current width, and once a resetting dictionary is full
+         * the next codeword must be CLEAR or EOF, as it must after the
+         * last codeword before a sync point
+        */
+        if(k == got && (header.flags & LZWHeader::HUFFMAN)){
+            /**
+             * Each codeword is coded against the number valid in its place:
+             * fewer than i after a reset, else up to i, the entry about to
+             * be added; a batch is read ahead with a copy of i and prev
+             * that follows them exactly as decoding below will
+            */
+            LZWTimer io(stats.io_seconds, &stats.dictionary_seconds);
+            if(!entropy){
+                entropy.emplace(LZWEntropy::read(in));
+                bits += LZWEntropy::TABLE_SIZE * 8;
+            }
+            int next = i; // i once the codewords read so far are decoded
+            bool fresh = prev < 0; // Whether the next codeword follows a reset
+            int used = 0;
+            got = 0;
+            while(got < BATCH){
+                const uint32_t n = static_cast<uint32_t>(fresh ? next : std::min(next + 1, L));
+                const int codeword = static_cast<int>(entropy->get(in, n, used));
+                codes[got++] = codeword;
+                if(codeword == LZWHeader::EOF_CODE) break;
+                if(fresh) fresh = false;
+                else if(codeword == LZWHeader::CLEAR){
+                    next = first;
+                    fresh = true;
+                }
+                else if(next < L) next++;
+            }
+            bits += used;
+            k = 0;
+        }
+        else if(k == got){
+            std::size_t batch = BATCH;
+            if(i < (1 << width)) batch = std::min(batch, static_cast<std::size_t>((1 << width) - i));
+            else if(reset) batch = 1;
+            if(sync > 0) batch = std::min<std::size_t>(batch, since_sync < sync ? sync - since_sync : 1);
+
+            {
+                LZWTimer io(stats.io_seconds, &stats.dictionary_seconds);
+                got = in.read_r(std::span<int>(codes.data(), batch), width);
+            }
+            k = 0;
+            bits += got * width;
+            if(got == 0){
+                flush_bytes();
+                return false;
+            }
+        }
+        const int codeword = codes[k++];
+
+        if(codeword == LZWHeader::EOF_CODE){
+            ended = true;
+            if(!(header.flags & LZWHeader::HUFFMAN)){
+                /* Codewords read past EOF in its batch are not part of the stream */
+                bits -= static_cast<uint64_t>(got - k) * width;
+                got = k;
+            }
+        }
+        else if(sync > 0 && since_sync == sync){
+            /* Sync point */
+            if(codeword != LZWHeader::CLEAR) throw(std::invalid_argument("Corrupt compressed stream"));
+            i = first;
+            width = first_width;
+            prev = -1;
+            since_sync = 0;
+        }
+        else if(prev < 0){
+            /* First codeword after the start or a reset is a single character or a trained entry */
+            if(codeword >= i || (codeword >= R && codeword < LZWHeader::FIRST)){
+                throw(std::invalid_argument("Corrupt compressed stream"));
+            }
+            head = expand(codeword);
+            prev = codeword;
+            since_sync++;
+            if constexpr(LZW_STATS_ENABLED) stats.codewords++;
+        }
+        else if(codeword == LZWHeader::CLEAR){
+            i = first;
+            width = first_width;
+            prev = -1;
+            if constexpr(LZW_STATS_ENABLED) stats.resets++;
+        }
+        else{
+            if(codeword > i) throw(std::invalid_argument("Corrupt compressed stream"));
+
+            /* The new entry is the previous string plus the first byte of this one */
+            const bool special = codeword == i; // This string is the entry about to be added
+            if(!special) head = expand(codeword);
+            if(i < L){
+                prefix[i] = prev;
+                last[i] = head;
+                length[i] = length[prev] + 1;
+                i++;
+                if(i >= (1 << width) && width < header.max_width) width++;
+            }
+            if(special) expand(codeword);
+            prev = codeword;
+            since_sync++;
+            if constexpr(LZW_STATS_ENABLED){
+                stats.codewords++;
+                if(i == L && stats.fill_point == 0) stats.fill_point = stats.raw_bytes + used;
+            }
+        }
+    }
+
+    flush_bytes();
+    return true;
+}
+
+static inline uint64_t load_bits(std::span<const unsigned char> in, uint64_t bit){
+    /**
+     * @param in    Input bytes
+     * @param bit   Bit position in in
+     * @returns The 64 bits at bit, first bit most significant; at least
+     *  57 of them come from in, and any past its end are 0
+    */
+
+    const std::size_t at = bit >> 3;
+    uint64_t w = 0;
+    if(at + sizeof w <= in.size()){
+        std::memcpy(&w, in.data() + at, sizeof w);
+        if constexpr(std::endian::native == std::endian::little) w = __builtin_bswap64(w);
+    }
+    else{
+        for(std::size_t j=at; j<in.size(); ++j) w |= static_cast<uint64_t>(in[j]) << (56 - 8 * (j - at));
+    }
+    return w << (bit & 7);
+}
+
+static inline unsigned char* put(unsigned char* o, unsigned char* end, const unsigned char* from, uint32_t n,
+    std::size_t slack){
+    /**
+     * Copies a string that ends at or before o to o
+     * Where there is room, the copy is 16 bytes at a time and may
+     * write up to slack bytes past the string; from must then have
+     * slack readable bytes past the string too
+     *
+     * @param o Where to put the string
+     * @param end   End of the output
+     * @param from  The string
+     * @param n Its length
+     * @param slack Bytes after it that may be overwritten
+     * @returns Position just past the string
+     * @throws invalid_argument if the string does not fit before end
+    */
+
+    const std::size_t room = static_cast<std::size_t>(end - o);
+    if(n + slack <= room){
+        for(uint32_t j=0; j<n; j+=16){
+            uint64_t a, b;
+            std::memcpy(&a, from + j, 8);
+            std::memcpy(&b, from + j + 8, 8);
+            std::memcpy(o + j, &a, 8);
+            std::memcpy(o + j + 8, &b, 8);
+        }
+    }
+    else if(n <= room) std::memcpy(o, from, n);
+    else throw(std::invalid_argument("Corrupt compressed stream"));
+    return o + n;
+}
+
+template<bool Huffman, int W>
+std::size_t LZWDecoder::decode_block(std::span<const unsigned char> in, std::span<unsigned char> out){
+    /**
+     * Private member for decode() of a block, with or without the
+     * Huffman stage, so the loop has no test for it
+     * W is the width of every codeword of a fixed width stream, so
+     * cutting one from the window is a constant shift, or 0 for a
+     * stream whose width grows
+     *
+     * @param in    The block's codeword stream
+     * @param out   Buffer for the expanded bytes
+     * @returns Number of bytes of out used
+     * @throws invalid_argument if the codewords are not a valid stream or out is too small
+     * @throws ifstream::failure if in ends before the EOF codeword
+    */
+
+    const int R = LZWHeader::R;
+    const int L = 1 << header.max_width; // Number of codewords
+    const uint64_t limit = static_cast<uint64_t>(in.size()) * 8; // Bits of input
+    unsigned char* const base = out.data();
+    unsigned char* const end = base + out.size();
+    unsigned char* o = base; // Where the next string goes
+    unsigned char* at = base; // Where the string just expanded is
+    LZWTimer timer(stats.dictionary_seconds);
+
+    uint64_t bit = 0; // Position of the next codeword in in
+    if constexpr(Huffman){
+        BinaryFIn table_in;
+        table_in.initialize(in);
+        entropy.emplace(LZWEntropy::read(table_in));
+        bit = LZWEntropy::TABLE_SIZE * 8;
+    }
+    uint64_t window = 0; // Bits from bit on, high first
+    int left = 0; // Bits of window taken from in and not yet used
+
+    while(true){
+        /* A load covers several codewords; a Huffman one is at most 32 bits */
+        const int need = Huffman ? 32 : (W > 0 ? W : width);
+        if(left < need){
+            window = load_bits(in, bit);
+            left = 64 - static_cast<int>(bit & 7);
+        }
+        int codeword;
+        int taken;
+        if constexpr(Huffman){
+            const uint32_t n = static_cast<uint32_t>(prev < 0 ? i : std::min(i + 1, L));
+            codeword = static_cast<int>(entropy->lookup(static_cast<uint32_t>(window >> 32), n, taken));
+        }
+        else{
+            taken = W > 0 ? W : width;
+            codeword = static_cast<int>(window >> (64 - taken));
+        }
+        window <<= taken;
+        left -= taken;
+        bit += taken;
+        if(bit > limit) throw(std::ifstream::failure("Compressed stream ended before EOF codeword"));
+
+        if(codeword == LZWHeader::EOF_CODE) break;
+        if(prev < 0){
+            /* First codeword after the start or a reset is a single character or a trained entry */
+            if(codeword >= i || (codeword >= R && codeword < LZWHeader::FIRST)){
+                throw(std::invalid_argument("Corrupt compressed stream"));
+            }
+            at = o;
+            o = put(o, end, origin[codeword], length[codeword], SLACK);
+            prev = codeword;
+            if constexpr(LZW_STATS_ENABLED) stats.codewords++;
+        }
+        else if(codeword == LZWHeader::CLEAR){
+            i = first;
+            width = first_width;
+            prev = -1;
+            if constexpr(LZW_STATS_ENABLED) stats.resets++;
+        }
+        else{
+            if(codeword > i) throw(std::invalid_argument("Corrupt compressed stream"));
+
+            /* The new entry is the previous string plus the first byte of this one, so it starts at at */
+            const uint32_t before = length[prev];
+            unsigned char* const start = o;
+            if(codeword == i){
+                /* This string is the entry about to be added: the previous string and its own first byte */
+                o = put(o, end, at, before, SLACK);
+                if(o == end) throw(std::invalid_argument("Corrupt compressed stream"));
+                *o++ = *start;
+            }
+            else o = put(o, end, origin[codeword], length[codeword], SLACK);
+            if(i < L){
+                origin[i] = at;
+                length[i] = before + 1;
+                i++;
+                if constexpr(W == 0){
+                    if(i >= (1 << width) && width < header.max_width) width++;
+                }
+            }
+            at = start;
+            prev = codeword;
+            if constexpr(LZW_STATS_ENABLED){
+                stats.codewords++;
+                if(i == L && stats.fill_point == 0) stats.fill_point = static_cast<uint64_t>(o - base);
+            }
+        }
+    }
+
+    ended = true;
+    bits = bit;
+    stats.raw_bytes = static_cast<uint64_t>(o - base);
+    stats.bytes_out = stats.raw_bytes;
+    return static_cast<std::size_t>(o - base);
+}
+
+std::size_t LZWDecoder::decode(std::span<const unsigned char> in, std::span<unsigned char> out){
+    /**
+     * Expands one whole codeword stream, such as a block, held in
+     * memory straight into out, without going through bit I/O objects
+     * A stream with sync points goes the usual way
+     *
+     * @param in    The codeword stream
+     * @param out   Buffer for the expanded bytes
+     * @returns Number of bytes of out used
+     * @throws invalid_argument if the codewords are not a valid stream or out is too small
+     * @throws ifstream::failure if in ends before the EOF codeword
+    */
+
+    start();
+    if(header.sync_interval > 0){
+        BinaryFIn source;
+        source.initialize(in);
+        BinaryFOut sink;
+        sink.initialize(out);
+        decode(source, sink);
+        sink.close();
+        return sink.tell();
+    }
+    if(header.flags & LZWHeader::HUFFMAN) return decode_block<true>(in, out);
+
+    /* Fixed widths that are common enough to have their own loop */
+    if(header.start_width() == header.max_width){
+        if(header.max_width == 12) return decode_block<false, 12>(in, out);
+        if(header.max_width == 16) return decode_block<false, 16>(in, out);
+    }
+    return decode_block<false>(in, out);
+}
+
+void LZWDecoder::decode(BinaryFIn& in, BinaryFOut& out, std::size_t limit){
+    /**
+     * Expands one codeword stream, starting from the single
+     * character dictionary and stopping after its EOF codeword
+     * or as soon as out holds at least limit bytes
+     *
+     * @param in    Input positioned at the first codeword
+     * @param out   Output for the expanded bytes
+     * @param limit Number of bytes of out (counted by out.tell()) after
+     *  which the rest of the stream is not needed
+     * @throws invalid_argument if the codewords are not a valid stream
+     * @throws ifstream::failure if in ends before the EOF codeword
+    */
+
+    start();
+    if(!resume(in, out, limit)){
+        throw(std::ifstream::failure("Compressed stream ended before EOF codeword"));
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef LZW_DECODER
+#define LZW_DECODER
+
+#include <vector>
+#include <span>
+#include <optional>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "BinaryFIn.hh"
+#include "BinaryFOut.hh"
+#include "LZWHeader.hh"
+#include "LZWEntropy.hh"
+#include "LZWStats.hh"
+
+class LZWDecoder{
+    private:
+        static const std::size_t BATCH = 1024; // Codewords moved per bit I/O call
+        static const std::size_t OUT = 1 << 16; // Bytes of decoded output collected per write
+        static const std::size_t SLACK = 16; // Bytes a wide copy may write past the end of a string
+        LZWHeader header; // Widths and dictionary mode to decode with
+        std::vector<uint32_t> prefix; // Symbol table: codeword of each entry's string without its last byte
+        std::vector<unsigned char> last; // Symbol table: last byte of each entry's string
+        std::vector<uint32_t> length; // Symbol table: length of each entry's string
+        std::vector<unsigned char> strings; // Bytes of the single characters and trained entries, then SLACK
+        std::vector<const unsigned char*> origin; // Symbol table of the block decoder: where each entry's string is
+        std::vector<int> codes; // Codewords read but not yet decoded
+        std::vector<unsigned char> bytes; // Decoded output not yet written, OUT plus room for the longest string
+        std::size_t used; // Number of bytes waiting in bytes
+        std::size_t k; // Next codeword in codes
+        std::size_t got; // Number of codewords in codes
+        int first; // First codeword added after a reset, past any trained entries
+        int first_width; // Codeword width after a reset
+        int i; // Next available codeword value
+        int width; // Current codeword width
+        int prev; // Codeword of the string just expanded, -1 at the start or after a reset
+        uint32_t since_sync; // Codewords for strings since the start or the last sync point
+        unsigned char head; // First byte of that string
+        bool ended; // Set once the EOF codeword has been decoded
+        uint64_t bits; // Number of bits of codewords read from input
+        std::optional<LZWEntropy> entropy; // Huffman code of the stream, read before its first codeword (HUFFMAN only)
+        LZWStats stats; // Counters since start()
+        unsigned char expand(int c);
+        template<bool Huffman, int W = 0>
+        std::size_t decode_block(std::span<const unsigned char> in, std::span<unsigned char> out);
+
+    public:
+        LZWDecoder(const LZWHeader& header);
+        LZWDecoder(const LZWDecoder&) = delete; // origin points into the decoder's own strings
+        LZWDecoder& operator=(const LZWDecoder&) = delete;
+        void start(); // Prepare for a new codeword stream, or a part of one starting at a sync point
+        bool resume(BinaryFIn& in, BinaryFOut& out,
+            std::size_t limit = std::numeric_limits<std::size_t>::max()); // Decode until EOF, the limit or the end of in
+        void decode(BinaryFIn& in, BinaryFOut& out,
+            std::size_t limit = std::numeric_limits<std::size_t>::max()); // Expand one codeword stream up to its EOF codeword
+        std::size_t decode(std::span<const unsigned char> in,
+            std::span<unsigned char> out); // Expand one whole codeword stream in memory, returns bytes used
+        bool done(); // Whether the EOF codeword has been decoded
+        uint64_t bits_read(); // Number of bits of input taken since start()
+        LZWStats statistics(); // Counters since start()
+};
+
+#endif
@@ -0,0 +1,278 @@
+/**
+ * Implementation of trained LZW dictionaries
+ *
+ * Training runs LZW over the sample, without resets, until the
+ * wanted number of strings has been learned, and keeps them
+ * The encoder's symbol table holding them is built once per
+ * dictionary backend, and at every reset the encoder restores it,
+ * copying only the storage the entries occupy (the whole slot table
+ * or node pool of HashDict or PoolDLB would be far more) rather
+ * than inserting each one again
+ *
+ * DEPENDENCIES:
+ *  ArenaDLB
+ *  HashDict
+ *  SimdDLB
+ *  PoolDLB
+ *  BinaryFIn
+ *  BinaryFOut
+ *  LZWHeader
+*/
+
+#include <stdexcept>
+#include <optional>
+#include <mutex>
+#include <utility>
+
+#include "ArenaDLB.hh"
+#include "HashDict.hh"
+#include "SimdDLB.hh"
+#include "PoolDLB.hh"
+#include "LZWHeader.hh"
+#include "LZWDictionary.hh"
+
+static const char MAGIC[3] = {'L', 'Z', 'D'}; // First bytes of every serialized dictionary
+
+template<class Dict>
+struct Snapshot{
+    std::once_flag once; // Guards building dict
+    std::optional<Dict> dict; // Symbol table with every entry, once built
+};
+
+struct LZWDictionary::Snapshots{
+    Snapshot<ArenaDLB> arena;
+    Snapshot<HashDict> hash;
+    Snapshot<SimdDLB> simd;
+    Snapshot<PoolDLB> pool;
+
+    Snapshot<ArenaDLB>& of(const ArenaDLB*){ return arena; }
+    Snapshot<HashDict>& of(const HashDict*){ return hash; }
+    Snapshot<SimdDLB>& of(const SimdDLB*){ return simd; }
+    Snapshot<PoolDLB>& of(const PoolDLB*){ return pool; }
+};
+
+/* Backends restored from a list of what is in use build it once, the rest need nothing */
+static void seal(HashDict& st){ st.seal(); }
+static void seal(PoolDLB& st){ st.seal(); }
+template<class Dict>
+static void seal(Dict&){}
+
+static std::size_t capacity(int max_width){
+    /**
+     * @param max_width Codeword width
+     * @returns Largest number of entries a dictionary for max_width
+     *  can hold, leaving at least one codeword for the input's strings
+    */
+
+    return (std::size_t(1) << max_width) - LZWHeader::FIRST - 1;
+}
+
+LZWDictionary::LZWDictionary(int max_width, std::vector<uint32_t> prefix, std::vector<unsigned char> last)
+    : width(max_width), prefix(std::move(prefix)), last(std::move(last)){
+    /**
+     * Private constructor with validated entries
+     * The id is the FNV-1a hash of the width and every entry
+     *
+     * @param max_width Codeword width the entries were learned for
+     * @param prefix    Codeword of each entry's prefix
+     * @param last  Last byte of each entry
+    */
+
+    identifier = 2166136261u;
+    auto mix = [&](uint32_t v){
+        for(int b=0; b<4; ++b){
+            identifier = (identifier ^ ((v >> (8 * b)) & 0xff)) * 16777619u;
+        }
+    };
+    mix(static_cast<uint32_t>(width));
+    for(std::size_t j=0; j<this->prefix.size(); ++j){
+        mix(this->prefix[j]);
+        mix(this->last[j]);
+    }
+    snapshots = std::make_shared<Snapshots>();
+}
+
+LZWDictionary LZWDictionary::train(std::span<const std::byte> sample, int max_width, std::size_t entries){
+    /**
+     * Learns a dictionary from a sample of the data it will compress
+     * LZW runs over the sample as the encoder would, from the single
+     * characters, and the first entries strings it learns are kept;
+     * a sample made of many typical messages works best
+     *
+     * @param sample    Bytes like those that will be compressed
+     * @param max_width Codeword width files using the dictionary will have
+     * @param entries   Number of strings to learn, 0 for half the codewords
+     * @returns Dictionary with up to entries strings, fewer if the sample runs out
+     * @throws invalid_argument if max_width is out of range, or entries
+     *  leaves no codeword for the input's own strings
+    */
+
+    if(max_width < LZWHeader::MIN_WIDTH || max_width > LZWHeader::MAX_WIDTH){
+        throw(std::invalid_argument("Codeword width must be from 9 to 20"));
+    }
+    if(entries == 0) entries = ((std::size_t(1) << max_width) - LZWHeader::FIRST) / 2;
+    if(entries > capacity(max_width)){
+        throw(std::invalid_argument("Too many entries for the codeword width"));
+    }
+
+    std::vector<uint32_t> prefix;
+    std::vector<unsigned char> last;
+    prefix.reserve(entries);
+    last.reserve(entries);
+
+    ArenaDLB st(LZWHeader::FIRST + entries);
+    for(int i=0; i<LZWHeader::R; ++i){
+        st.add_child(ArenaDLB::NIL, static_cast<char>(i), i);
+    }
+
+    uint32_t cur = ArenaDLB::NIL;
+    for(const std::byte& b : sample){
+        if(prefix.size() == entries) break;
+        const char c = static_cast<char>(b);
+        const uint32_t next = st.child(cur, c);
+        if(next != ArenaDLB::NIL){
+            cur = next;
+            continue;
+        }
+        const int code = LZWHeader::FIRST + static_cast<int>(prefix.size());
+        prefix.push_back(static_cast<uint32_t>(st.key_of(cur)));
+        last.push_back(static_cast<unsigned char>(b));
+        st.add_child(cur, c, code);
+        cur = st.child(ArenaDLB::NIL, c);
+    }
+
+    return LZWDictionary(max_width, std::move(prefix), std::move(last));
+}
+
+LZWDictionary LZWDictionary::read(BinaryFIn& in){
+    /**
+     * Reads a dictionary written by write()
+     *
+     * @param in    Input positioned at the start of a serialized dictionary
+     * @returns The dictionary, with the same id as when it was written
+     * @throws invalid_argument if the input is not a valid dictionary
+     * @throws ifstream::failure if the input ends inside it
+    */
+
+    for(char c : MAGIC){
+        if(in.read_char() != c) throw(std::invalid_argument("Not an LZW dictionary"));
+    }
+    if(static_cast<unsigned char>(in.read_char()) != VERSION){
+        throw(std::invalid_argument("Unsupported LZW dictionary version"));
+    }
+    const int max_width = static_cast<unsigned char>(in.read_char());
+    if(max_width < LZWHeader::MIN_WIDTH || max_width > LZWHeader::MAX_WIDTH){
+        throw(std::invalid_argument("Corrupt LZW dictionary"));
+    }
+    const uint32_t count = static_cast<uint32_t>(in.read_int());
+    if(count > capacity(max_width)) throw(std::invalid_argument("Corrupt LZW dictionary"));
+
+    std::vector<uint32_t> prefix(count);
+    std::vector<unsigned char> last(count);
+    for(uint32_t j=0; j<count; ++j){
+        prefix[j] = static_cast<uint32_t>(in.read_r(max_width));
+        last[j] = static_cast<unsigned char>(in.read_r(8));
+        // Every prefix is a single character or an earlier entry
+        const uint32_t code = LZWHeader::FIRST + j;
+        if(prefix[j] >= code || (prefix[j] >= LZWHeader::R && prefix[j] < LZWHeader::FIRST)){
+            throw(std::invalid_argument("Corrupt LZW dictionary"));
+        }
+    }
+
+    return LZWDictionary(max_width, std::move(prefix), std::move(last));
+}
+
+void LZWDictionary::write(BinaryFOut& out) const{
+    /**
+     * Serializes the dictionary, ending on a whole byte
+     *
+     * @param out   Output to write the dictionary to, expected to be byte-aligned
+    */
+
+    for(char c : MAGIC) out.write(c);
+    out.write(static_cast<char>(VERSION));
+    out.write(static_cast<char>(width));
+    out.write(static_cast<int>(prefix.size()));
+    for(std::size_t j=0; j<prefix.size(); ++j){
+        out.write(static_cast<int>(prefix[j]), width);
+        out.write(static_cast<char>(last[j]));
+    }
+    const std::size_t bits = prefix.size() * width; // Bytes of last keep whole bytes whole
+    if(bits % 8 != 0) out.write(0, static_cast<int>(8 - bits % 8));
+}
+
+uint32_t LZWDictionary::id() const{
+    /**
+     * @returns Hash of the width and entries, recorded in the header
+     *  of every file compressed with the dictionary
+    */
+
+    return identifier;
+}
+
+int LZWDictionary::max_width() const{
+    /**
+     * @returns Codeword width the dictionary was trained for, which
+     *  files compressed with it must use
+    */
+
+    return width;
+}
+
+std::size_t LZWDictionary::size() const{
+    /**
+     * @returns Number of entries, which take the codewords from
+     *  LZWHeader::FIRST on
+    */
+
+    return prefix.size();
+}
+
+std::span<const uint32_t> LZWDictionary::prefixes() const{
+    /**
+     * @returns Codeword of the prefix of each entry, in codeword order
+    */
+
+    return prefix;
+}
+
+std::span<const unsigned char> LZWDictionary::lasts() const{
+    /**
+     * @returns Last byte of each entry, in codeword order
+    */
+
+    return last;
+}
+
+template<class Dict>
+const Dict& LZWDictionary::primed() const{
+    /**
+     * Builds, on first use by any thread, the encoder's symbol table
+     * holding the single characters and every entry, sized for
+     * max_width; encoders restore() from it rather than inserting the entries
+     *
+     * @returns Symbol table to restore at the start and at every reset
+    */
+
+    Snapshot<Dict>& s = snapshots->of(static_cast<const Dict*>(nullptr));
+    std::call_once(s.once, [&](){
+        Dict st(std::size_t(1) << width);
+        std::vector<uint32_t> node(LZWHeader::FIRST + prefix.size()); // Node of each codeword's string
+        for(int i=0; i<LZWHeader::R; ++i){
+            node[i] = st.add_child(Dict::NIL, static_cast<char>(i), i);
+        }
+        for(std::size_t j=0; j<prefix.size(); ++j){
+            const int code = LZWHeader::FIRST + static_cast<int>(j);
+            node[code] = st.add_child(node[prefix[j]], static_cast<char>(last[j]), code);
+        }
+        seal(st);
+        s.dict.emplace(std::move(st));
+    });
+    return *s.dict;
+}
+
+/* Dictionaries the encoder can be built with */
+template const ArenaDLB& LZWDictionary::primed<ArenaDLB>() const;
+template const HashDict& LZWDictionary::primed<HashDict>() const;
+template const SimdDLB& LZWDictionary::primed<SimdDLB>() const;
+template const PoolDLB& LZWDictionary::primed<PoolDLB>() const;
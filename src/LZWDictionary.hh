@@ -0,0 +1,57 @@
+#ifndef LZW_DICTIONARY
+#define LZW_DICTIONARY
+
+#include <vector>
+#include <span>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+#include "BinaryFIn.hh"
+#include "BinaryFOut.hh"
+
+class LZWDictionary{
+    /**
+     * Trained dictionary: strings learned from a sample that
+     * compression and expansion start from instead of only the
+     * 256 single characters, so short messages like the sample
+     * shrink from their first bytes
+     * Entries take the codewords right after CLEAR, in the order
+     * LZW learned them, each stored as the codeword of its prefix
+     * and its last byte
+     * A file compressed with a dictionary records its id and
+     * can only be expanded with the same dictionary
+     *
+     * Serialized layout:
+     *  'L' 'Z' 'D' version max_width (one byte each)
+     *  count (4 bytes)
+     *  prefix (max_width bits) last (8 bits)    for every entry,
+     *  padded with 0s to a whole byte
+    */
+
+    private:
+        struct Snapshots; // Primed symbol table of each encoder dictionary, built once
+        int width; // max_width the dictionary was trained for
+        std::vector<uint32_t> prefix; // Codeword of each entry's string without its last byte
+        std::vector<unsigned char> last; // Last byte of each entry's string
+        uint32_t identifier; // Hash of the width and every entry
+        std::shared_ptr<Snapshots> snapshots; // Shared by copies, since the entries never change
+        LZWDictionary(int max_width, std::vector<uint32_t> prefix, std::vector<unsigned char> last);
+
+    public:
+        static const unsigned char VERSION = 1; // Format version written by this build
+        static LZWDictionary train(std::span<const std::byte> sample, int max_width = 12,
+            std::size_t entries = 0); // Learn entries from sample, 0 entries for half the codewords
+        static LZWDictionary read(BinaryFIn& in); // Read and validate a serialized dictionary
+        void write(BinaryFOut& out) const; // Serialize the dictionary
+
+        uint32_t id() const; // Identifier recorded in the header of every file using the dictionary
+        int max_width() const; // Codeword width the dictionary was trained for
+        std::size_t size() const; // Number of entries, beyond the single characters
+        std::span<const uint32_t> prefixes() const; // Codeword of each entry's prefix
+        std::span<const unsigned char> lasts() const; // Last byte of each entry
+        template<class Dict>
+        const Dict& primed() const; // Symbol table holding every entry, to restore at each reset
+};
+
+#endif
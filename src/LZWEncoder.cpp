@@ -0,0 +1,404 @@
+/**
+ * Implementation of the LZW codeword encoder
+ *
+ * Consumes input one span at a time and walks the trie one
+ * byte at a time, emitting a codeword whenever the current
+ * match cannot be extended, so any amount of input is encoded
+ * in linear time while holding only the dictionary
+ *
+ * Codewords are min_width bits until the next codeword to assign
+ * no longer fits, then grow a bit at a time up to max_width
+ * Once full the dictionary is reset (after a CLEAR codeword)
+ * or frozen, as the header says
+ * With sync points every sync_interval codewords also end in a
+ * CLEAR, recording where the next part of the stream starts
+ * With a trained dictionary every reset restores its primed symbol
+ * table, copying only what the trained entries occupy, instead of
+ * inserting the single characters
+ * With Huffman coding the codewords are kept until finish(), which
+ * fits a code to them and writes it before them
+ *
+ * With an effort above 0 the input is parsed flexibly rather than
+ * greedily: at each codeword up to effort matches shorter than the
+ * longest are tried, and one is taken if it and the longest match
+ * after it reach past the next three greedy matches, so it saves
+ * a codeword; the one reaching furthest wins
+ * Expansion adds an entry for every codeword all the same, so when a
+ * shorter match plus the next byte is already an entry its codeword
+ * is left unused, and the stream expands like any other
+ * Input is held until no choice can depend on bytes still to come
+ *
+ * The dictionary is a template parameter, so each backend gets
+ * its own copy of the loop with the lookups inlined
+ *
+ * DEPENDENCIES:
+ *  ArenaDLB
+ *  HashDict
+ *  SimdDLB
+ *  PoolDLB
+ *  BinaryFOut
+ *  LZWHeader
+ *  LZWDictionary
+ *  LZWEntropy
+ *  LZWStats
+*/
+
+#include <span>
+#include <algorithm>
+#include <stdexcept>
+
+#include "LZWDictionary.hh"
+#include "LZWEntropy.hh"
+#include "LZWEncoder.hh"
+
+template<class Dict>
+BasicLZWEncoder<Dict>::BasicLZWEncoder(const LZWHeader& header, BinaryFOut& out, int effort)
+    : header(header), effort(effort), out(out){
+    /**
+     * Constructor with the mode to encode with and where to write codewords
+     * The header itself is not written
+     *
+     * @param header    Widths and dictionary mode
+     * @param out   Output for codewords, must outlive the encoder
+     * @param effort    Shorter matches to try at each codeword, 0 to
+     *  always take the longest
+     * @throws invalid_argument if the header's widths are out of range,
+     *  it needs a trained dictionary that is not attached, or effort
+     *  is not from 0 to MAX_EFFORT
+    */
+
+    if(effort < 0 || effort > MAX_EFFORT){
+        throw(std::invalid_argument("Effort must be from 0 to 16"));
+    }
+    header.validate();
+    header.start_code();
+    L = 1 << header.max_width;
+    st = Dict(L);
+    codes.resize(BATCH);
+    restart();
+}
+
+template<class Dict>
+void BasicLZWEncoder<Dict>::restart(){
+    /**
+     * Starts a new codeword stream at the output's current position,
+     * as a newly constructed encoder would, but keeps the symbol
+     * table's storage, so encoding many small inputs allocates nothing
+     * Anything not yet written by finish() is dropped
+    */
+
+    k = 0;
+    cur = Dict::NIL;
+    origin = static_cast<uint64_t>(out.tell()) * 8;
+    bits = 0;
+    since_sync = 0;
+    part_start = 0;
+    earlier_visits = 0 - st.visited(); // Wraps, so only visits from now on are counted
+    sync.parts.clear();
+    pending.clear();
+    held.clear();
+    held_start = 0;
+    if(header.flags & LZWHeader::SYNC) sync.parts.push_back({origin, 0});
+    stats = LZWStats();
+    reset_dictionary();
+}
+
+template<class Dict>
+void BasicLZWEncoder<Dict>::reset_dictionary(){
+    /**
+     * Private member to return the dictionary to the single
+     * characters, or the trained dictionary's entries, and the
+     * narrowest width
+    */
+
+    if(header.dictionary != nullptr){
+        st.restore(header.dictionary->template primed<Dict>());
+    }
+    else{
+        st.clear();
+        for(int i=0; i<LZWHeader::R; ++i){
+            st.add_child(Dict::NIL, static_cast<char>(i), i);
+        }
+    }
+    code = header.start_code();
+    width = header.start_width();
+}
+
+template<class Dict>
+void BasicLZWEncoder<Dict>::flush_codes(){
+    /**
+     * Private member to write out waiting codewords
+     * Called before every width change
+    */
+
+    LZWTimer timer(stats.io_seconds, &stats.dictionary_seconds);
+    out.write(std::span<const int>(codes.data(), k), width);
+    bits += k * width;
+    k = 0;
+}
+
+template<class Dict>
+void BasicLZWEncoder<Dict>::emit(int codeword){
+    /**
+     * Private member to queue a codeword of the current width
+     * With Huffman coding it is kept with the number of codewords
+     * expansion will accept in its place: every one assigned so far
+     * (the one the decoder is about to add among them)
+     *
+     * @param codeword  Codeword to write
+    */
+
+    if(header.flags & LZWHeader::HUFFMAN){
+        pending.push_back(static_cast<uint32_t>(codeword));
+        pending.push_back(static_cast<uint32_t>(code));
+        return;
+    }
+    codes[k++] = codeword;
+    if(k == BATCH) flush_codes();
+}
+
+template<class Dict>
+void BasicLZWEncoder<Dict>::sync_point(uint64_t raw){
+    /**
+     * Private member to end the current part of the stream after
+     * its last codeword, so the next part decodes on its own
+     * Like finish(), the CLEAR is written at the width expansion
+     * will have reached after adding its last entry
+     *
+     * @param raw   Raw bytes encoded before the next part
+    */
+
+    if(code >= (1 << width) && width < header.max_width){
+        flush_codes();
+        width++;
+    }
+    emit(LZWHeader::CLEAR);
+    flush_codes();
+    reset_dictionary();
+    since_sync = 0;
+
+    sync.parts.back().raw_size = raw - part_start;
+    sync.parts.push_back({origin + bits, 0});
+    part_start = raw;
+}
+
+template<class Dict>
+void BasicLZWEncoder<Dict>::end_match(uint32_t match, char c, uint64_t raw, bool known_new){
+    /**
+     * Private member to write the codeword for a match that the next
+     * byte does not extend, and add the match plus that byte as the
+     * next entry, reset the dictionary or end a part of the stream
+     *
+     * @param match Node of the match
+     * @param c Byte after the match
+     * @param raw   Raw bytes before c
+     * @param known_new Whether match + c is known not to be an entry,
+     *  as when match is the longest; otherwise it is looked up, and if
+     *  it is an entry its codeword is left unused
+    */
+
+    emit(st.key_of(match)); // output match's encoding
+    if constexpr(LZW_STATS_ENABLED) stats.codewords++;
+    if(header.sync_interval > 0 && ++since_sync == header.sync_interval){
+        sync_point(raw);
+    }
+    else if(code < L){
+        if(known_new || st.child(match, c) == Dict::NIL) st.add_child(match, c, code); // match + c
+        code++;
+        if constexpr(LZW_STATS_ENABLED){
+            if(code == L && stats.fill_point == 0) stats.fill_point = raw;
+        }
+        // Widen once the largest assigned codeword no longer fits
+        if(code > (1 << width) && width < header.max_width){
+            flush_codes();
+            width++;
+        }
+    }
+    else if(header.flags & LZWHeader::RESET){
+        emit(LZWHeader::CLEAR);
+        flush_codes();
+        reset_dictionary();
+        if constexpr(LZW_STATS_ENABLED) stats.resets++;
+    }
+}
+
+template<class Dict>
+std::size_t BasicLZWEncoder<Dict>::longest(std::size_t at, bool& open, bool record){
+    /**
+     * Private member finding the longest match in held
+     *
+     * @param at    Position of the match in held
+     * @param open  Set when the match runs to the end of held, so
+     *  more input could make it longer
+     * @param record    Whether to keep the node of each prefix in path
+     * @returns Length of the match
+    */
+
+    if(record) path.clear();
+    uint32_t node = Dict::NIL;
+    std::size_t n = 0;
+    for(; at + n < held.size(); ++n){
+        const uint32_t next = st.child(node, static_cast<char>(held[at + n]));
+        if(next == Dict::NIL){
+            open = false;
+            return n;
+        }
+        node = next;
+        if(record) path.push_back(node);
+    }
+    open = true;
+    return n;
+}
+
+template<class Dict>
+void BasicLZWEncoder<Dict>::parse(bool final){
+    /**
+     * Private member to encode held input flexibly, one codeword at a
+     * time, until a choice depends on input still to come
+     * The match at the end of the input is left in cur for finish()
+     *
+     * @param final Whether the input has ended
+    */
+
+    std::size_t at = 0; // Start of the next match in held
+    while(at < held.size()){
+        bool open;
+        const std::size_t m = longest(at, open, true);
+        if(open && !final) break;
+        if(open){
+            cur = path.back(); // The final match
+            at = held.size();
+            break;
+        }
+
+        /* A shorter match adds no entry, so take one only if it saves a codeword over the next three longest */
+        std::size_t best = m;
+        const std::size_t next = longest(at + m, open, false);
+        bool wait = open && !final;
+        std::size_t reach = m + next;
+        if(!open){
+            reach += longest(at + m + next, open, false);
+            wait = open && !final;
+        }
+        const std::size_t shortest = m > static_cast<std::size_t>(effort) ? m - effort : 1;
+        for(std::size_t k=m-1; k>=shortest && !wait; --k){
+            const std::size_t r = k + longest(at + k, open, false);
+            wait = open && !final;
+            if(r > reach){
+                best = k;
+                reach = r;
+            }
+        }
+        if(wait) break;
+
+        end_match(path[best - 1], static_cast<char>(held[at + best]), held_start + at + best, best == m);
+        at += best;
+    }
+
+    held.erase(held.begin(), held.begin() + at);
+    held_start += at;
+}
+
+template<class Dict>
+void BasicLZWEncoder<Dict>::encode(std::span<const unsigned char> bytes){
+    /**
+     * Encodes the next bytes of input
+     * A match may continue across calls, so the codeword
+     * for the final bytes is only written by finish()
+     *
+     * @param bytes Next bytes of input
+    */
+
+    LZWTimer timer(stats.dictionary_seconds);
+
+    if(effort > 0){
+        held.insert(held.end(), bytes.begin(), bytes.end());
+        parse(false);
+        stats.raw_bytes += bytes.size();
+        stats.bytes_in += bytes.size();
+        return;
+    }
+
+    for(const unsigned char& b : bytes){
+        const char c = static_cast<char>(b);
+        uint32_t next = st.child(cur, c);
+        if(next != Dict::NIL){
+            cur = next; // Match extends by c
+            continue;
+        }
+
+        end_match(cur, c, stats.raw_bytes + (&b - bytes.data()), true);
+        cur = st.child(Dict::NIL, c); // start next match at c
+    }
+    stats.raw_bytes += bytes.size();
+    stats.bytes_in += bytes.size();
+}
+
+template<class Dict>
+void BasicLZWEncoder<Dict>::finish(){
+    /**
+     * Writes the codeword for the final match and the EOF codeword,
+     * padded with 0s to a whole byte
+     * The output is left unflushed and open
+    */
+
+    LZWTimer timer(stats.dictionary_seconds);
+
+    if(effort > 0) parse(true);
+    const bool matched = cur != Dict::NIL;
+    if(matched){
+        emit(st.key_of(cur)); // flush final match
+        if constexpr(LZW_STATS_ENABLED) stats.codewords++;
+    }
+    cur = Dict::NIL;
+
+    // Expansion adds one more entry before reading EOF, so it may be a bit wider
+    if(code >= (1 << width) && width < header.max_width){
+        flush_codes();
+        width++;
+    }
+    emit(LZWHeader::EOF_CODE);
+    flush_codes();
+    if(header.flags & LZWHeader::HUFFMAN){
+        if(matched) pending.back() = std::min(code + 1, L); // Expansion adds the entry for the final match first
+        LZWTimer io(stats.io_seconds, &stats.dictionary_seconds);
+        uint32_t counts[LZWEntropy::BINS] = {};
+        for(std::size_t j=0; j<pending.size(); j+=2) counts[LZWEntropy::bin(pending[j], pending[j + 1])]++;
+        const LZWEntropy entropy = LZWEntropy::build(counts);
+        entropy.write(out);
+        bits += LZWEntropy::TABLE_SIZE * 8;
+        for(std::size_t j=0; j<pending.size(); j+=2) bits += entropy.put(out, pending[j], pending[j + 1]);
+        pending.clear();
+    }
+    if(bits % 8 != 0) out.write(0, static_cast<int>(8 - bits % 8));
+
+    if(header.flags & LZWHeader::SYNC) sync.parts.back().raw_size = stats.raw_bytes - part_start;
+}
+
+template<class Dict>
+const LZWSyncIndex& BasicLZWEncoder<Dict>::sync_index(){
+    /**
+     * @returns Bit offset and raw size of every part of the stream,
+     *  empty without sync points; the index's end is left to the caller
+    */
+
+    return sync;
+}
+
+template<class Dict>
+LZWStats BasicLZWEncoder<Dict>::statistics(){
+    /**
+     * @returns Counters for the input encoded so far; bytes_out
+     *  is left to the caller, which knows where the output went
+    */
+
+    LZWStats s = stats;
+    s.nodes_visited = earlier_visits + st.visited();
+    return s;
+}
+
+/* Dictionaries LZW can be built with */
+template class BasicLZWEncoder<ArenaDLB>;
+template class BasicLZWEncoder<HashDict>;
+template class BasicLZWEncoder<SimdDLB>;
+template class BasicLZWEncoder<PoolDLB>;
@@ -0,0 +1,62 @@
+#ifndef LZW_ENCODER
+#define LZW_ENCODER
+
+#include <vector>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+
+#include "ArenaDLB.hh"
+#include "HashDict.hh"
+#include "SimdDLB.hh"
+#include "PoolDLB.hh"
+#include "BinaryFOut.hh"
+#include "LZWHeader.hh"
+#include "LZWStats.hh"
+
+template<class Dict>
+class BasicLZWEncoder{
+    private:
+        static const std::size_t BATCH = 1024; // Codewords moved per bit I/O call
+        LZWHeader header; // Widths and dictionary mode to encode with
+        int effort; // Shorter matches tried at each codeword, 0 for the longest match only
+        BinaryFOut& out; // Output for codewords
+        Dict st; // Symbol table, one node per codeword (ArenaDLB, HashDict, SimdDLB or PoolDLB)
+        int L; // Number of codewords (2^max_width)
+        int code; // Next codeword to assign
+        int width; // Current codeword width
+        uint32_t cur; // Node of the current (longest so far) match, NIL before any input
+        std::vector<int> codes; // Codewords waiting to be written, all of the current width
+        std::size_t k; // Number of codewords waiting
+        uint64_t origin; // Bit offset in out where the codewords start
+        uint64_t bits; // Number of bits of codewords written
+        uint32_t since_sync; // Codewords for strings since the last sync point (SYNC only)
+        uint64_t part_start; // Raw bytes before the current part of the stream (SYNC only)
+        LZWSyncIndex sync; // Parts of the stream so far (SYNC only)
+        std::vector<uint32_t> pending; // Codeword then number of valid codewords, for each codeword of the block (HUFFMAN only)
+        std::vector<unsigned char> held; // Input not yet parsed, while it could still change a choice (effort only)
+        uint64_t held_start; // Raw bytes before held (effort only)
+        std::vector<uint32_t> path; // Node of each prefix of the longest match being parsed (effort only)
+        uint64_t earlier_visits; // Minus the nodes visited before restart(), so only later visits are counted
+        LZWStats stats; // Counters for the input encoded so far
+        void emit(int codeword);
+        void end_match(uint32_t match, char c, uint64_t raw, bool known_new);
+        std::size_t longest(std::size_t at, bool& open, bool record);
+        void parse(bool final);
+        void flush_codes();
+        void reset_dictionary();
+        void sync_point(uint64_t raw);
+
+    public:
+        static const int MAX_EFFORT = 16; // Most shorter matches tried at each codeword
+        BasicLZWEncoder(const LZWHeader& header, BinaryFOut& out, int effort = 0);
+        void restart(); // Start a new stream at out's current position, reusing the dictionary's storage
+        void encode(std::span<const unsigned char> bytes); // Encode the next bytes of input
+        void finish(); // Write the final match and EOF codeword
+        const LZWSyncIndex& sync_index(); // Parts of the stream, complete after finish()
+        LZWStats statistics(); // Counters for the input encoded so far
+};
+
+using LZWEncoder = BasicLZWEncoder<ArenaDLB>; // Encoder with the default dictionary
+
+#endif
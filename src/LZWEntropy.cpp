@@ -0,0 +1,169 @@
+/**
+ * Implementation of the per-block Huffman stage
+ *
+ * Codes are built from the bin counts of a whole block with a
+ * heap, and while the longest is over MAX_LENGTH the counts are
+ * halved (keeping every used bin at least 1) and the code rebuilt,
+ * which flattens the tree until it fits
+ * Only the lengths are stored: codes are canonical, assigned in
+ * order of length then bin, so the decoder rebuilds them and fills
+ * a table of every MAX_LENGTH-bit prefix with the bin and length
+ * of the code it starts with
+ *
+ * DEPENDENCIES:
+ *  BinaryFIn
+ *  BinaryFOut
+*/
+
+#include <algorithm>
+#include <queue>
+#include <functional>
+#include <stdexcept>
+
+#include "LZWEntropy.hh"
+
+static void fit(std::span<const uint64_t> counts, unsigned char* lengths){
+    /**
+     * Huffman code lengths for counts, without a length limit
+     *
+     * @param counts    Count of each symbol, 0 for a symbol not used
+     * @param lengths   Code length of each symbol, set to 0 for those not used
+    */
+
+    const std::size_t symbols = counts.size();
+    std::vector<int> parent(2 * symbols, -1); // Node each node was merged into
+    std::priority_queue<std::pair<uint64_t, int>, std::vector<std::pair<uint64_t, int>>,
+        std::greater<std::pair<uint64_t, int>>> heap; // (count, node) with the smallest count on top
+    for(std::size_t j=0; j<symbols; ++j){
+        lengths[j] = 0;
+        if(counts[j] > 0) heap.push({counts[j], static_cast<int>(j)});
+    }
+    if(heap.size() == 1){
+        lengths[heap.top().second] = 1; // A lone symbol still takes one bit
+        return;
+    }
+
+    int next = static_cast<int>(symbols);
+    while(heap.size() > 1){
+        const auto a = heap.top();
+        heap.pop();
+        const auto b = heap.top();
+        heap.pop();
+        parent[a.second] = next;
+        parent[b.second] = next;
+        heap.push({a.first + b.first, next++});
+    }
+    for(std::size_t j=0; j<symbols; ++j){
+        if(counts[j] == 0) continue;
+        int depth = 0;
+        for(int node = static_cast<int>(j); parent[node] >= 0; node = parent[node]) depth++;
+        lengths[j] = static_cast<unsigned char>(depth);
+    }
+}
+
+LZWEntropy LZWEntropy::build(std::span<const uint32_t> counts){
+    /**
+     * Fits a code to the bins a block's codewords fall in
+     *
+     * @param counts    Number of codewords in each of the BINS bins,
+     *  at least one of them nonzero
+     * @returns Code with every used bin's code at most MAX_LENGTH bits
+    */
+
+    LZWEntropy code;
+    std::vector<uint64_t> scaled(counts.begin(), counts.end());
+    for(;;){
+        fit(scaled, code.lengths);
+        if(*std::max_element(code.lengths, code.lengths + BINS) <= MAX_LENGTH) break;
+        for(uint64_t& c : scaled){
+            if(c > 0) c = (c + 1) / 2;
+        }
+    }
+    code.assign();
+    return code;
+}
+
+void LZWEntropy::assign(){
+    /**
+     * Private member giving each used bin its canonical code:
+     * shorter codes first, and bins of equal length in order
+    */
+
+    uint16_t next = 0;
+    for(int length=1; length<=MAX_LENGTH; ++length){
+        for(int b=0; b<BINS; ++b){
+            if(lengths[b] == length) codes[b] = next++;
+        }
+        next <<= 1;
+    }
+}
+
+LZWEntropy LZWEntropy::read(BinaryFIn& in){
+    /**
+     * Reads a block's code and builds its decoding table
+     *
+     * @param in    Input positioned at the start of the block
+     * @returns Code ready for get()
+     * @throws invalid_argument if the lengths are not a prefix code
+     * @throws ifstream::failure if in ends inside them
+    */
+
+    LZWEntropy code;
+    uint32_t space = 0; // Table entries taken, 1 << MAX_LENGTH for a complete code
+    for(int b=0; b<BINS; ++b){
+        code.lengths[b] = static_cast<unsigned char>(in.read_r(4));
+        if(code.lengths[b] > MAX_LENGTH) throw(std::invalid_argument("Corrupt compressed block"));
+        if(code.lengths[b] > 0) space += 1u << (MAX_LENGTH - code.lengths[b]);
+    }
+    if(space == 0 || space > (1u << MAX_LENGTH)) throw(std::invalid_argument("Corrupt compressed block"));
+    code.assign();
+
+    code.table.assign(std::size_t(1) << MAX_LENGTH, 0); // Length 0 marks bits that start no code
+    for(int b=0; b<BINS; ++b){
+        const int length = code.lengths[b];
+        if(length == 0) continue;
+        const uint32_t first = static_cast<uint32_t>(code.codes[b]) << (MAX_LENGTH - length);
+        std::fill_n(code.table.begin() + first, std::size_t(1) << (MAX_LENGTH - length),
+            static_cast<uint16_t>((b << 4) | length));
+    }
+    return code;
+}
+
+void LZWEntropy::write(BinaryFOut& out) const{
+    /**
+     * Writes the code lengths, TABLE_SIZE bytes
+     *
+     * @param out   Output at the start of the block
+    */
+
+    for(int b=0; b<BINS; ++b) out.write(static_cast<int>(lengths[b]), 4);
+}
+
+int LZWEntropy::put(BinaryFOut& out, uint32_t c, uint32_t n) const{
+    /**
+     * Writes one codeword: its bin's code, then its offset in the bin
+     *
+     * @param out   Output for the codeword
+     * @param c Codeword, below n
+     * @param n Number of codewords valid at its place in the stream
+     * @returns Number of bits written
+    */
+
+    const int b = bin(c, n);
+    out.write(static_cast<int>(codes[b]), lengths[b]);
+
+    const uint32_t lo = static_cast<uint32_t>(((static_cast<uint64_t>(b) * n) + BINS - 1) >> BIN_BITS);
+    const uint32_t hi = static_cast<uint32_t>(((static_cast<uint64_t>(b + 1) * n) + BINS - 1) >> BIN_BITS);
+    const uint32_t size = hi - lo;
+    if(size == 1) return lengths[b];
+
+    const int k = std::bit_width(size) - 1;
+    const uint32_t u = (2u << k) - size;
+    const uint32_t v = c - lo;
+    if(v < u){
+        out.write(static_cast<int>(v), k);
+        return lengths[b] + k;
+    }
+    out.write(static_cast<int>(v + u), k + 1);
+    return lengths[b] + k + 1;
+}
@@ -0,0 +1,117 @@
+#ifndef LZW_ENTROPY
+#define LZW_ENTROPY
+
+#include <vector>
+#include <span>
+#include <bit>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+
+#include "BinaryFIn.hh"
+#include "BinaryFOut.hh"
+
+class LZWEntropy{
+    /**
+     * Canonical Huffman code for the codewords of one block
+     * (the HUFFMAN flag)
+     * A codeword c is only ever one of the n codewords valid at
+     * its place in the stream, and older, shorter strings are used
+     * more than the ones just added, so c is coded as the bin
+     * (c * BINS / n) it falls in, with a Huffman code fitted to
+     * the block, then its offset in the bin in truncated binary
+     *
+     * Layout of a block's code, before its codewords:
+     *  length of each bin's code (4 bits each, 0 for a bin not used)
+    */
+
+    public:
+        static const int BIN_BITS = 6;
+        static const int BINS = 1 << BIN_BITS; // Symbols of the Huffman code
+        static const int MAX_LENGTH = 12; // Longest code, so one table lookup decodes any bin
+        static const std::size_t TABLE_SIZE = BINS * 4 / 8; // Bytes of the code lengths
+
+    private:
+        unsigned char lengths[BINS]; // Code length of each bin, 0 if not used
+        uint16_t codes[BINS]; // Canonical code of each bin
+        std::vector<uint16_t> table; // Bin and code length of every MAX_LENGTH-bit prefix, built by read()
+        void assign(); // Canonical codes from the lengths
+
+    public:
+        static LZWEntropy build(std::span<const uint32_t> counts); // Code fitted to counts of each bin
+        static LZWEntropy read(BinaryFIn& in); // Read and validate a block's code
+        void write(BinaryFOut& out) const; // Write the code lengths
+        static int bin(uint32_t c, uint32_t n); // Bin of codeword c among n valid codewords
+        int put(BinaryFOut& out, uint32_t c, uint32_t n) const; // Write c, returns bits written
+        uint32_t get(BinaryFIn& in, uint32_t n, int& used) const; // Read a codeword, adding its bits to used
+        uint32_t lookup(uint32_t x, uint32_t n, int& bits) const; // Codeword at the front of 32 peeked bits
+};
+
+inline int LZWEntropy::bin(uint32_t c, uint32_t n){
+    /**
+     * @param c Codeword, below n
+     * @param n Number of codewords valid at its place in the stream
+     * @returns Bin of c; bin b holds the codewords from ceil(b * n / BINS)
+     *  up to, not including, ceil((b + 1) * n / BINS)
+    */
+
+    return static_cast<int>((static_cast<uint64_t>(c) << BIN_BITS) / n);
+}
+
+inline uint32_t LZWEntropy::lookup(uint32_t x, uint32_t n, int& bits) const{
+    /**
+     * Decodes the codeword at the front of bits already looked at:
+     * the bin's code through the table, then the offset in the bin
+     *
+     * @param x The next 32 bits of input, padded with 0s past its end
+     * @param n Number of codewords valid at its place in the stream
+     * @param bits  Set to the number of bits of x the codeword takes
+     * @returns The codeword, below n
+     * @throws invalid_argument if the bits are no bin's code
+    */
+
+    const uint16_t entry = table[x >> (32 - MAX_LENGTH)];
+    const int length = entry & 0xf;
+    if(length == 0) throw(std::invalid_argument("Corrupt compressed block"));
+
+    const uint32_t b = entry >> 4;
+    const uint32_t lo = static_cast<uint32_t>(((static_cast<uint64_t>(b) * n) + BINS - 1) >> BIN_BITS);
+    const uint32_t hi = static_cast<uint32_t>(((static_cast<uint64_t>(b + 1) * n) + BINS - 1) >> BIN_BITS);
+    const uint32_t size = hi - lo;
+    if(size <= 1){
+        if(size == 0) throw(std::invalid_argument("Corrupt compressed block"));
+        bits = length;
+        return lo;
+    }
+
+    /* Truncated binary: the first u offsets take k bits, the rest k + 1 */
+    const int k = std::bit_width(size) - 1;
+    const uint32_t u = (2u << k) - size;
+    const uint32_t rest = x << length; // Bits after the bin's code
+    const uint32_t shorter = rest >> (32 - k);
+    const bool longer = shorter >= u; // Either way is as likely, so no branch
+    bits = length + k + longer;
+    return lo + (longer ? (rest >> (31 - k)) - u : shorter);
+}
+
+inline uint32_t LZWEntropy::get(BinaryFIn& in, uint32_t n, int& used) const{
+    /**
+     * Reads one codeword
+     *
+     * @param in    Input positioned at the codeword
+     * @param n Number of codewords valid at its place in the stream
+     * @param used  Number of bits read so far, increased by the codeword's
+     * @returns The codeword, below n
+     * @throws invalid_argument if the bits are no bin's code
+     * @throws ifstream::failure if in ends inside the codeword
+    */
+
+    /* A whole codeword is at most MAX_LENGTH + MAX_WIDTH - BIN_BITS bits, so one look covers it */
+    int bits = 0;
+    const uint32_t c = lookup(in.peek_r(32), n, bits);
+    in.skip_r(bits);
+    used += bits;
+    return c;
+}
+
+#endif
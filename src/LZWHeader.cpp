@@ -0,0 +1,332 @@
+/**
+ * Implementation of the LZW file header and block index
+ * The header is written before the first codeword so expand() knows
+ * which width and dictionary mode to decode with
+ * The block index follows the blocks of a BLOCKS file so they
+ * can be located without decoding the ones before them, and the
+ * sync index follows the codewords of a SYNC file so its parts can
+ * be decoded in parallel
+*/
+
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <cstdio>
+#include "LZWHeader.hh"
+#include "LZWDictionary.hh"
+
+static const char MAGIC[3] = {'L', 'Z', 'W'}; // First bytes of every compressed file
+
+void LZWHeader::validate() const{
+    /**
+     * Checks that the header describes a mode this build can handle
+     *
+     * @throws invalid_argument if widths are out of range, or the
+     *  flags are unknown, ask for both blocks and sync points, or
+     *  ask for Huffman coding without blocks
+    */
+
+    if(min_width < MIN_WIDTH || max_width > MAX_WIDTH || min_width > max_width){
+        throw(std::invalid_argument("Codeword widths must satisfy 9 <= min <= max <= 20"));
+    }
+    if(flags & ~(RESET | BLOCKS | SYNC | DICT | HUFFMAN)){
+        throw(std::invalid_argument("Unknown LZW header flags"));
+    }
+    if((flags & BLOCKS) && block_size == 0){
+        throw(std::invalid_argument("Block size must be positive"));
+    }
+    if((flags & SYNC) && (flags & BLOCKS)){
+        throw(std::invalid_argument("Sync points need a single stream, not blocks"));
+    }
+    if((flags & HUFFMAN) && !(flags & BLOCKS)){
+        throw(std::invalid_argument("Huffman coding works per block, so it needs blocks"));
+    }
+    if(((flags & SYNC) != 0) != (sync_interval != 0)){
+        throw(std::invalid_argument("Sync interval must be positive exactly when there are sync points"));
+    }
+    if(dictionary != nullptr && dictionary->max_width() != max_width){
+        throw(std::invalid_argument("Trained dictionary is for a different codeword width"));
+    }
+}
+
+std::size_t LZWHeader::size() const{
+    /**
+     * @returns Number of bytes write() writes, the offset of the first codeword
+    */
+
+    return size(flags);
+}
+
+std::size_t LZWHeader::size(unsigned char flags){
+    /**
+     * Lets a reader tell how much of the input the header
+     * needs from its fixed part alone
+     *
+     * @param flags Flags byte of a header
+     * @returns Number of bytes in a header with those flags
+    */
+
+    return SIZE + ((flags & BLOCKS) ? sizeof(uint32_t) : 0) + ((flags & SYNC) ? sizeof(uint32_t) : 0)
+        + ((flags & DICT) ? sizeof(uint32_t) : 0);
+}
+
+void LZWHeader::use(const LZWDictionary* trained){
+    /**
+     * Attaches the trained dictionary a file read with this header
+     * was compressed with; ignored if it used none
+     *
+     * @param trained   Dictionary given by the caller, nullptr for none
+     * @throws invalid_argument if the file needs a dictionary and
+     *  trained is missing or is a different one
+    */
+
+    if(!(flags & DICT)){
+        dictionary = nullptr;
+        return;
+    }
+
+    char id[16];
+    std::snprintf(id, sizeof id, "%08x", static_cast<unsigned>(dictionary_id));
+    if(trained == nullptr){
+        throw(std::invalid_argument(std::string("Compressed with trained dictionary ") + id + ", which was not given"));
+    }
+    if(trained->id() != dictionary_id){
+        throw(std::invalid_argument(std::string("Compressed with trained dictionary ") + id + ", not the one given"));
+    }
+    dictionary = trained;
+    validate();
+}
+
+int LZWHeader::start_code() const{
+    /**
+     * @returns FIRST, or the codeword after the trained dictionary's entries
+     * @throws invalid_argument if the header needs a trained dictionary
+     *  that has not been attached
+    */
+
+    if(!(flags & DICT)) return FIRST;
+    if(dictionary == nullptr) throw(std::invalid_argument("Compressed with a trained dictionary, which was not given"));
+    return FIRST + static_cast<int>(dictionary->size());
+}
+
+int LZWHeader::start_width() const{
+    /**
+     * The narrowest width holding start_code(), so the encoder's first
+     * codeword after a reset is as wide as the decoder expects
+     *
+     * @returns Codeword width after a reset
+    */
+
+    const int code = start_code();
+    int width = min_width;
+    while(code >= (1 << width) && width < max_width) width++;
+    return width;
+}
+
+uint64_t LZWHeader::max_expansion(uint64_t bytes) const{
+    /**
+     * Bounds what a stream can expand to, so sizes read from a file
+     * can be checked before anything is allocated for them
+     * Every codeword takes at least min_width bits (1 when Huffman
+     * coded) and no string is longer than the number of codewords
+     *
+     * @param bytes Size of a codeword stream in bytes
+     * @returns Most bytes it can expand to
+    */
+
+    const uint64_t codewords = bytes * 8 / ((flags & HUFFMAN) ? 1 : min_width);
+    if(codewords > (std::numeric_limits<uint64_t>::max() >> max_width)) return std::numeric_limits<uint64_t>::max();
+    return codewords << max_width;
+}
+
+void LZWHeader::write(BinaryFOut& out) const{
+    /**
+     * Writes the header as whole bytes
+     *
+     * @param out   Output to write the header to, expected to be byte-aligned
+    */
+
+    validate();
+
+    for(char c : MAGIC) out.write(c);
+    out.write(static_cast<char>(VERSION));
+    out.write(static_cast<char>(flags));
+    out.write(static_cast<char>(min_width));
+    out.write(static_cast<char>(max_width));
+    if(flags & BLOCKS) out.write(static_cast<int>(block_size));
+    if(flags & SYNC) out.write(static_cast<int>(sync_interval));
+    if(flags & DICT) out.write(static_cast<int>(dictionary_id));
+}
+
+LZWHeader LZWHeader::read(BinaryFIn& in){
+    /**
+     * Reads and validates a header
+     * A file compressed with a trained dictionary also needs that
+     * dictionary attached with use() before it is expanded
+     *
+     * @param in    Input positioned at the start of a compressed file
+     * @returns Header describing how the file was compressed
+     * @throws invalid_argument if the input is not a compressed file
+     *  or was written by a newer, incompatible version
+     * @throws ifstream::failure if the input ends inside the header
+    */
+
+    for(char c : MAGIC){
+        if(in.read_char() != c) throw(std::invalid_argument("Not an LZW compressed file"));
+    }
+    if(static_cast<unsigned char>(in.read_char()) != VERSION){
+        throw(std::invalid_argument("Unsupported LZW format version"));
+    }
+
+    LZWHeader header;
+    header.flags = static_cast<unsigned char>(in.read_char());
+    header.min_width = static_cast<unsigned char>(in.read_char());
+    header.max_width = static_cast<unsigned char>(in.read_char());
+    if(header.flags & BLOCKS) header.block_size = static_cast<uint32_t>(in.read_int());
+    if(header.flags & SYNC) header.sync_interval = static_cast<uint32_t>(in.read_int());
+    if(header.flags & DICT) header.dictionary_id = static_cast<uint32_t>(in.read_int());
+    header.validate();
+
+    return header;
+}
+
+void LZWBlockIndex::write(BinaryFOut& out) const{
+    /**
+     * Writes the index entries followed by the trailer
+     *
+     * @param out   Output positioned after the last block, byte-aligned
+    */
+
+    const uint64_t index_offset = out.tell();
+    for(const Entry& e : blocks){
+        out.write(static_cast<long>(e.offset));
+        out.write(static_cast<long>(e.size));
+        out.write(static_cast<long>(e.raw_size));
+    }
+    out.write(static_cast<long>(index_offset));
+    out.write(static_cast<long>(blocks.size()));
+}
+
+LZWBlockIndex LZWBlockIndex::read(BinaryFIn& in, const LZWHeader& header){
+    /**
+     * Reads the index by first reading the trailer at the end of the input
+     * Leaves in positioned at the end of the index
+     *
+     * @param in    Input holding a complete BLOCKS file
+     * @param header    Header of the file
+     * @returns Index of every block in the file
+     * @throws invalid_argument if the trailer or index is inconsistent
+    */
+
+    return read(in, header, 0, std::numeric_limits<std::size_t>::max());
+}
+
+LZWBlockIndex LZWBlockIndex::read(BinaryFIn& in, const LZWHeader& header, std::size_t first, std::size_t count){
+    /**
+     * Reads part of the index, seeking straight to the entries
+     * wanted so the cost does not grow with the number of blocks
+     * Leaves in positioned after the last entry read
+     * No block may be bigger than the block size, or than its
+     * codewords can expand to, so a corrupt entry is caught
+     * before its size is allocated
+     *
+     * @param in    Input holding a complete BLOCKS file
+     * @param header    Header of the file
+     * @param first Number of the first block to read
+     * @param count Number of entries to read, fewer if the file ends first
+     * @returns Index holding the entries read, with first and total set
+     * @throws invalid_argument if the trailer or index is inconsistent
+    */
+
+    const std::size_t length = in.size();
+    if(length < TRAILER_SIZE) throw(std::invalid_argument("Compressed file is missing its block index"));
+
+    in.seek(length - TRAILER_SIZE);
+    const uint64_t index_offset = static_cast<uint64_t>(in.read_long());
+    const uint64_t total = static_cast<uint64_t>(in.read_long());
+    const uint64_t entry_bytes = 3 * sizeof(uint64_t);
+    if(index_offset > length - TRAILER_SIZE || total != (length - TRAILER_SIZE - index_offset) / entry_bytes){
+        throw(std::invalid_argument("Corrupt block index"));
+    }
+
+    LZWBlockIndex index;
+    index.first = first;
+    index.total = total;
+    if(first >= total) return index;
+
+    index.blocks.resize(std::min<uint64_t>(count, total - first));
+    in.seek(index_offset + first * entry_bytes);
+    for(Entry& e : index.blocks){
+        e.offset = static_cast<uint64_t>(in.read_long());
+        e.size = static_cast<uint64_t>(in.read_long());
+        e.raw_size = static_cast<uint64_t>(in.read_long());
+        if(e.offset > index_offset || e.size > index_offset - e.offset
+            || e.raw_size > header.block_size || e.raw_size > header.max_expansion(e.size)){
+            throw(std::invalid_argument("Corrupt block index"));
+        }
+    }
+
+    return index;
+}
+
+void LZWSyncIndex::write(BinaryFOut& out) const{
+    /**
+     * Writes the index entries followed by the trailer
+     *
+     * @param out   Output positioned after the codeword stream, byte-aligned
+    */
+
+    const uint64_t index_offset = out.tell();
+    for(const Entry& e : parts){
+        out.write(static_cast<long>(e.bit_offset));
+        out.write(static_cast<long>(e.raw_size));
+    }
+    out.write(static_cast<long>(index_offset));
+    out.write(static_cast<long>(parts.size()));
+}
+
+LZWSyncIndex LZWSyncIndex::read(BinaryFIn& in, const LZWHeader& header){
+    /**
+     * Reads the index by first reading the trailer at the end of the input
+     * Leaves in positioned at the end of the index
+     * No part may be bigger than its codewords can expand to, so a
+     * corrupt entry is caught before its size is allocated
+     *
+     * @param in    Input holding a complete SYNC file
+     * @param header    Header of the file
+     * @returns Index of every part of the stream
+     * @throws invalid_argument if the trailer or index is inconsistent
+    */
+
+    const std::size_t length = in.size();
+    if(length < TRAILER_SIZE) throw(std::invalid_argument("Compressed file is missing its sync index"));
+
+    in.seek(length - TRAILER_SIZE);
+    const uint64_t index_offset = static_cast<uint64_t>(in.read_long());
+    const uint64_t total = static_cast<uint64_t>(in.read_long());
+    const uint64_t entry_bytes = 2 * sizeof(uint64_t);
+    if(index_offset > length - TRAILER_SIZE || total == 0 || total != (length - TRAILER_SIZE - index_offset) / entry_bytes){
+        throw(std::invalid_argument("Corrupt sync index"));
+    }
+
+    LZWSyncIndex index;
+    index.end = index_offset;
+    index.parts.resize(total);
+    in.seek(index_offset);
+    uint64_t previous = 0;
+    for(Entry& e : index.parts){
+        e.bit_offset = static_cast<uint64_t>(in.read_long());
+        e.raw_size = static_cast<uint64_t>(in.read_long());
+        if(e.bit_offset < previous || e.bit_offset / 8 >= index_offset){
+            throw(std::invalid_argument("Corrupt sync index"));
+        }
+        previous = e.bit_offset + 1;
+    }
+    for(std::size_t j=0; j<index.parts.size(); ++j){
+        const uint64_t next = j + 1 < index.parts.size() ? index.parts[j + 1].bit_offset : index_offset * 8;
+        const uint64_t bytes = (next - index.parts[j].bit_offset + 7) / 8;
+        if(index.parts[j].raw_size > header.max_expansion(bytes)) throw(std::invalid_argument("Corrupt sync index"));
+    }
+
+    return index;
+}
@@ -0,0 +1,120 @@
+#ifndef LZW_HEADER
+#define LZW_HEADER
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "BinaryFIn.hh"
+#include "BinaryFOut.hh"
+
+class LZWDictionary;
+
+struct LZWHeader{
+    /**
+     * Small header written at the start of every compressed file
+     * Records the mode the file was compressed with so
+     * expansion can pick it up automatically
+     *
+     * Layout (one byte each unless noted):
+     *  'L' 'Z' 'W' version flags min_width max_width
+     *  block_size (4 bytes, only with the BLOCKS flag)
+     *  sync_interval (4 bytes, only with the SYNC flag)
+     *  dictionary_id (4 bytes, only with the DICT flag)
+    */
+
+    static const unsigned char VERSION = 1; // Format version written by this build
+    static const std::size_t SIZE = 7; // Bytes in a header without the BLOCKS flag
+    static const int MIN_WIDTH = 9; // Narrowest codeword (256 characters + EOF + CLEAR)
+    static const int MAX_WIDTH = 20; // Widest codeword supported
+
+    /* Codewords with a fixed meaning */
+    static const int R = 256; // Number of input characters, codewords 0 to R-1
+    static const int EOF_CODE = R; // Codeword marking end of input
+    static const int CLEAR = R + 1; // Codeword marking a dictionary reset
+    static const int FIRST = R + 2; // First codeword assigned to a multi-character string
+
+    /* Flags */
+    static const unsigned char RESET = 0x01; // Dictionary is reset when full, otherwise frozen
+    static const unsigned char BLOCKS = 0x02; // Input split into independently compressed blocks
+    static const unsigned char SYNC = 0x04; // One stream with sync points, located through an LZWSyncIndex
+    static const unsigned char DICT = 0x08; // Dictionary starts from a trained LZWDictionary, not only single characters
+    static const unsigned char HUFFMAN = 0x10; // Each block's codewords are Huffman coded through an LZWEntropy
+
+    unsigned char flags = RESET; // Mode flags
+    int min_width = 9; // Width codewords start at
+    int max_width = 16; // Width codewords grow to
+    uint32_t block_size = 0; // Uncompressed bytes per block (BLOCKS only)
+    uint32_t sync_interval = 0; // Codewords for strings between sync points (SYNC only)
+    uint32_t dictionary_id = 0; // Id of the trained dictionary (DICT only)
+    const LZWDictionary* dictionary = nullptr; // That dictionary, supplied by the caller rather than stored in the file
+
+    void validate() const; // Check fields are in range
+    std::size_t size() const; // Bytes the header takes in the file
+    static std::size_t size(unsigned char flags); // Bytes a header with these flags takes
+    void use(const LZWDictionary* trained); // Attach the trained dictionary a file read needs
+    int start_code() const; // First codeword added after a reset
+    int start_width() const; // Codeword width after a reset
+    uint64_t max_expansion(uint64_t bytes) const; // Most bytes that bytes of codewords can expand to
+    void write(BinaryFOut& out) const; // Write header to out
+    static LZWHeader read(BinaryFIn& in); // Read and validate header from in
+};
+
+struct LZWBlockIndex{
+    /**
+     * Index written after the last block of a BLOCKS file
+     * Each block is a complete codeword stream (ending in EOF,
+     * padded to a byte) compressed with its own dictionary
+     *
+     * Layout (8-byte big-endian fields):
+     *  offset size raw_size    for every block, in order
+     *  index_offset count      trailer, always the last 16 bytes of the file
+    */
+
+    struct Entry{
+        uint64_t offset; // Byte offset of the block in the file
+        uint64_t size; // Compressed size of the block in bytes
+        uint64_t raw_size; // Uncompressed size of the block in bytes
+    };
+
+    static const std::size_t TRAILER_SIZE = 16; // Bytes in the trailer
+
+    std::vector<Entry> blocks; // Blocks in file order
+    std::size_t first = 0; // Number of the block held in blocks[0]
+    std::size_t total = 0; // Number of blocks in the file (blocks.size() unless read in part)
+
+    void write(BinaryFOut& out) const; // Write index and trailer to out
+    static LZWBlockIndex read(BinaryFIn& in, const LZWHeader& header); // Read index using the trailer at the end of in
+    static LZWBlockIndex read(BinaryFIn& in, const LZWHeader& header,
+        std::size_t first, std::size_t count); // Read only entries first to first+count-1
+};
+
+struct LZWSyncIndex{
+    /**
+     * Index written after the codeword stream of a SYNC file
+     * Every sync_interval codewords for strings the encoder writes
+     * a CLEAR, so the next part of the stream starts from the single
+     * character dictionary and the narrowest width, and can be
+     * decoded from its recorded bit offset without the parts before it
+     * The stream is padded to a whole byte before the index
+     *
+     * Layout (8-byte big-endian fields):
+     *  bit_offset raw_size    for every part, in order
+     *  index_offset count     trailer, always the last 16 bytes of the file
+    */
+
+    struct Entry{
+        uint64_t bit_offset; // Bit offset of the part's first codeword from the start of the file
+        uint64_t raw_size; // Uncompressed size of the part in bytes
+    };
+
+    static const std::size_t TRAILER_SIZE = 16; // Bytes in the trailer
+
+    std::vector<Entry> parts; // Parts in stream order, the first starting right after the header
+    uint64_t end = 0; // Byte offset just past the codeword stream, where the index starts
+
+    void write(BinaryFOut& out) const; // Write index and trailer to out
+    static LZWSyncIndex read(BinaryFIn& in, const LZWHeader& header); // Read index using the trailer at the end of in
+};
+
+#endif
@@ -0,0 +1,71 @@
+/**
+ * Implementation of the LZW run statistics
+ *
+ * Derived figures and the JSON form of the counters
+ * collected by the encoder, decoder and LZW
+*/
+
+#include <string>
+#include <cstdio>
+
+#include "LZWStats.hh"
+
+double LZWStats::average_match() const{
+    /**
+     * @returns Average number of raw bytes per codeword, 0 if none were counted
+    */
+
+    return codewords == 0 ? 0 : static_cast<double>(raw_bytes) / codewords;
+}
+
+double LZWStats::nodes_per_byte() const{
+    /**
+     * @returns Average number of dictionary nodes visited per raw byte
+     *  compressed, 0 if none were counted
+    */
+
+    return raw_bytes == 0 ? 0 : static_cast<double>(nodes_visited) / raw_bytes;
+}
+
+void LZWStats::add(const LZWStats& other){
+    /**
+     * Adds the counters of another block or stream to these
+     * The fill point kept is the earliest of the two
+     *
+     * @param other Statistics to add
+    */
+
+    bytes_in += other.bytes_in;
+    bytes_out += other.bytes_out;
+    raw_bytes += other.raw_bytes;
+    blocks += other.blocks;
+    parts += other.parts;
+    codewords += other.codewords;
+    resets += other.resets;
+    if(other.fill_point != 0 && (fill_point == 0 || other.fill_point < fill_point)) fill_point = other.fill_point;
+    nodes_visited += other.nodes_visited;
+    io_seconds += other.io_seconds;
+    dictionary_seconds += other.dictionary_seconds;
+}
+
+std::string LZWStats::json() const{
+    /**
+     * @returns Every counter and derived figure as one JSON object,
+     *  with "enabled" telling whether the optional counters were collected
+    */
+
+    char s[640];
+    std::snprintf(s, sizeof s,
+        "{\"enabled\": %s, \"bytes_in\": %llu, \"bytes_out\": %llu, \"raw_bytes\": %llu, \"blocks\": %llu, \"parts\": %llu, "
+        "\"codewords\": %llu, \"resets\": %llu, \"fill_point\": %llu, \"nodes_visited\": %llu, "
+        "\"average_match\": %.4f, \"nodes_per_byte\": %.4f, "
+        "\"io_seconds\": %.6f, \"dictionary_seconds\": %.6f}",
+        LZW_STATS_ENABLED ? "true" : "false",
+        static_cast<unsigned long long>(bytes_in), static_cast<unsigned long long>(bytes_out),
+        static_cast<unsigned long long>(raw_bytes), static_cast<unsigned long long>(blocks),
+        static_cast<unsigned long long>(parts),
+        static_cast<unsigned long long>(codewords), static_cast<unsigned long long>(resets),
+        static_cast<unsigned long long>(fill_point), static_cast<unsigned long long>(nodes_visited),
+        average_match(), nodes_per_byte(), io_seconds, dictionary_seconds);
+    return s;
+}
@@ -0,0 +1,75 @@
+#ifndef LZW_STATS_COMP
+#define LZW_STATS_COMP
+
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Counters are only collected when built with LZW_STATS defined
+ * (cmake -DLZW_ENABLE_STATS=ON); otherwise every counting statement
+ * is discarded at compile time and the hot loops are unchanged
+*/
+#if defined(LZW_STATS)
+inline constexpr bool LZW_STATS_ENABLED = true;
+#else
+inline constexpr bool LZW_STATS_ENABLED = false;
+#endif
+
+struct LZWStats{
+    /**
+     * Statistics of one compression or expansion
+     * bytes_in, bytes_out, raw_bytes, blocks and parts are always filled in;
+     * the rest stay 0 unless LZW_STATS_ENABLED
+     * Times of blocks coded in parallel are summed over threads
+    */
+
+    uint64_t bytes_in = 0; // Bytes read: the raw input, or the compressed file when expanding
+    uint64_t bytes_out = 0; // Bytes written: the compressed file, or the expanded output
+    uint64_t raw_bytes = 0; // Uncompressed bytes: bytes_in when compressing, bytes_out when expanding
+    uint64_t blocks = 0; // Independently coded blocks, 0 for one stream
+    uint64_t parts = 0; // Parts of one stream split by sync points, 0 without sync points
+    uint64_t codewords = 0; // Codewords for strings, not counting CLEAR and EOF
+    uint64_t resets = 0; // Times the full dictionary was reset
+    uint64_t fill_point = 0; // Raw bytes into its stream when a dictionary first filled, 0 if none did
+    uint64_t nodes_visited = 0; // Dictionary nodes or slots looked at while compressing
+    double io_seconds = 0; // Time moving bits and bytes in and out of files and buffers
+    double dictionary_seconds = 0; // Time matching and building strings, without the I/O
+
+    double average_match() const; // Raw bytes per codeword
+    double nodes_per_byte() const; // Nodes visited per raw byte
+    void add(const LZWStats& other); // Combine with the statistics of another block
+    std::string json() const; // One JSON object holding every counter
+};
+
+class LZWTimer{
+    /**
+     * Adds the time between construction and destruction to a total,
+     * and optionally takes it back out of an enclosing timer's total
+     * so nested I/O is not counted twice
+     * Does nothing unless LZW_STATS_ENABLED
+    */
+
+    private:
+        double& total; // Total to add to
+        double* enclosing; // Total to take the time back out of, nullptr for none
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        LZWTimer(double& total, double* enclosing = nullptr) : total(total), enclosing(enclosing){
+            if constexpr(LZW_STATS_ENABLED) start = std::chrono::steady_clock::now();
+        }
+
+        ~LZWTimer(){
+            if constexpr(LZW_STATS_ENABLED){
+                const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                total += s;
+                if(enclosing != nullptr) *enclosing -= s;
+            }
+        }
+
+        LZWTimer(const LZWTimer&) = delete;
+        LZWTimer& operator=(const LZWTimer&) = delete;
+};
+
+#endif
@@ -0,0 +1,251 @@
+/**
+ * Implementation of incremental LZW compression and expansion
+ *
+ * Input arrives in chunks of any size, for streams whose length
+ * is not known up front, and each call returns the output those
+ * chunks complete
+ * The encoder carries its dictionary, current match and pending
+ * bits across calls; the decoder carries its dictionary and
+ * the bits of a codeword split between chunks
+ * Memory stays bounded by the dictionary and the largest chunk,
+ * however long the stream runs
+ *
+ * Streams use the single codeword stream format, so they are
+ * also read by LZW::expand and written by LZW::compress
+ * with a block size of 0
+ *
+ * DEPENDENCIES:
+ *  BinaryFIn
+ *  BinaryFOut
+ *  LZWHeader
+ *  LZWEncoder
+ *  LZWDecoder
+ *  LZW
+*/
+
+#include <stdexcept>
+
+#include "LZWStream.hh"
+
+static LZWHeader stream_header(LZWOptions options){
+    /**
+     * @param options   Compression settings
+     * @returns Header for one codeword stream with those settings
+     * @throws invalid_argument if the settings are out of range
+    */
+
+    options.block_size = 0;
+    options.sync_interval = 0;
+    options.huffman = false;
+    return LZW::header(options);
+}
+
+LZWStreamEncoder::LZWStreamEncoder() : LZWStreamEncoder(LZWOptions()){
+}
+
+LZWStreamEncoder::LZWStreamEncoder(LZWOptions options)
+    : header(stream_header(options)), encoder(header, sink, options.effort){
+    /**
+     * Constructor with compression settings
+     * The header is returned by the first call
+     *
+     * @param options   Codeword widths, what to do when the dictionary fills
+     *  and any trained dictionary, which must outlive the encoder
+     * @throws invalid_argument if the settings are out of range
+    */
+
+    sink.initialize(output);
+    header.write(sink);
+    finished = false;
+}
+
+std::span<const unsigned char> LZWStreamEncoder::update(std::span<const unsigned char> input){
+    /**
+     * Compresses the next chunk of the stream
+     * The final match and codewords still being batched are held
+     * back, so output lags the input a little until finish()
+     *
+     * @param input Next bytes of the stream
+     * @returns Compressed bytes, valid until the next call
+     * @throws invalid_argument if the stream has been finished
+    */
+
+    if(finished) throw(std::invalid_argument("Stream has already been finished"));
+
+    output.clear();
+    encoder.encode(input);
+    sink.drain();
+    return output;
+}
+
+std::span<const unsigned char> LZWStreamEncoder::finish(){
+    /**
+     * Ends the stream with the final match and the EOF codeword
+     *
+     * @returns The last compressed bytes, valid until the object is destroyed
+     * @throws invalid_argument if the stream has been finished
+    */
+
+    if(finished) throw(std::invalid_argument("Stream has already been finished"));
+
+    output.clear();
+    encoder.finish();
+    sink.close();
+    finished = true;
+    return output;
+}
+
+void LZWStreamEncoder::update(std::span<const unsigned char> input, BinaryFOut& out){
+    /**
+     * Compresses the next chunk of the stream to out
+     *
+     * @param input Next bytes of the stream
+     * @param out   Output for the compressed bytes
+     * @throws invalid_argument if the stream has been finished
+    */
+
+    std::span<const unsigned char> bytes = update(input);
+    out.write_bytes(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+void LZWStreamEncoder::finish(BinaryFOut& out){
+    /**
+     * Ends the stream to out
+     *
+     * @param out   Output for the last compressed bytes
+     * @throws invalid_argument if the stream has been finished
+    */
+
+    std::span<const unsigned char> bytes = finish();
+    out.write_bytes(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+std::size_t LZWStreamEncoder::update(BinaryFIn& in, BinaryFOut& out){
+    /**
+     * Compresses the next chunk of in to out
+     *
+     * @param in    Input to take up to 64 KiB from
+     * @param out   Output for the compressed bytes
+     * @returns Number of bytes taken from in, 0 once it is exhausted
+     * @throws invalid_argument if the stream has been finished
+    */
+
+    window.resize(WINDOW);
+    window.resize(in.read_bytes(reinterpret_cast<char*>(window.data()), window.size()));
+    update(window, out);
+    return window.size();
+}
+
+LZWStreamDecoder::LZWStreamDecoder() : LZWStreamDecoder(nullptr){
+}
+
+LZWStreamDecoder::LZWStreamDecoder(const LZWDictionary* dictionary) : dictionary(dictionary){
+    /**
+     * Constructor for a stream whose header has not arrived yet
+     *
+     * @param dictionary    Trained dictionary the stream was compressed with,
+     *  nullptr for none; must outlive the decoder
+    */
+
+    skip = 0;
+}
+
+void LZWStreamDecoder::update(std::span<const unsigned char> chunk, BinaryFOut& out){
+    /**
+     * Expands the next chunk of the stream to out
+     * Every codeword completed by the chunk is decoded; the bits
+     * of one split at the end are kept for the next call
+     *
+     * @param chunk Next bytes of the compressed stream
+     * @param out   Output for the expanded bytes
+     * @throws invalid_argument if the stream is not a valid codeword stream,
+     *  holds blocks or sync points, needs a trained dictionary that was
+     *  not given, or continues past its EOF codeword
+    */
+
+    if(done()){
+        if(!chunk.empty()) throw(std::invalid_argument("Data after the end of the compressed stream"));
+        return;
+    }
+
+    input.insert(input.end(), chunk.begin(), chunk.end());
+
+    if(!decoder){
+        if(input.size() < LZWHeader::SIZE || input.size() < LZWHeader::size(input[4])) return;
+        reader.initialize(input);
+        LZWHeader h = LZWHeader::read(reader);
+        h.use(dictionary);
+        if(h.flags & (LZWHeader::BLOCKS | LZWHeader::SYNC)){
+            throw(std::invalid_argument("Streams cannot hold blocks or sync points, use LZW::expand"));
+        }
+        decoder.emplace(h);
+        input.erase(input.begin(), input.begin() + h.size());
+    }
+
+    reader.initialize(input);
+    if(skip > 0) reader.read_r(static_cast<int>(skip));
+    const uint64_t before = decoder->bits_read();
+    decoder->resume(reader, out);
+
+    const std::size_t consumed = skip + (decoder->bits_read() - before); // Bits of input decoded
+    if(decoder->done()){
+        /* Only the padding of the EOF codeword's last byte may follow it */
+        const bool trailing = input.size() > (consumed + 7) / 8;
+        input.clear();
+        if(trailing) throw(std::invalid_argument("Data after the end of the compressed stream"));
+        return;
+    }
+    input.erase(input.begin(), input.begin() + consumed / 8);
+    skip = consumed % 8;
+}
+
+std::span<const unsigned char> LZWStreamDecoder::update(std::span<const unsigned char> chunk){
+    /**
+     * Expands the next chunk of the stream
+     *
+     * @param chunk Next bytes of the compressed stream
+     * @returns Expanded bytes, valid until the next call
+     * @throws invalid_argument if the stream is not a valid codeword stream,
+     *  holds blocks or sync points, or continues past its EOF codeword
+    */
+
+    output.clear();
+    sink.initialize(output);
+    update(chunk, sink);
+    sink.close();
+    return output;
+}
+
+std::size_t LZWStreamDecoder::update(BinaryFIn& in, BinaryFOut& out){
+    /**
+     * Expands the next chunk of in to out
+     *
+     * @param in    Input to take up to 64 KiB from
+     * @param out   Output for the expanded bytes
+     * @returns Number of bytes taken from in, 0 once it is exhausted
+     * @throws invalid_argument if the stream is not a valid codeword stream
+    */
+
+    window.resize(WINDOW);
+    window.resize(in.read_bytes(reinterpret_cast<char*>(window.data()), window.size()));
+    update(window, out);
+    return window.size();
+}
+
+bool LZWStreamDecoder::done(){
+    /**
+     * @returns Whether the EOF codeword has been decoded
+    */
+
+    return decoder && decoder->done();
+}
+
+void LZWStreamDecoder::finish(){
+    /**
+     * Checks that the input held the whole stream
+     *
+     * @throws ifstream::failure if the stream ended before its EOF codeword
+    */
+
+    if(!done()) throw(std::ifstream::failure("Compressed stream ended before EOF codeword"));
+}
@@ -0,0 +1,62 @@
+#ifndef LZW_STREAM
+#define LZW_STREAM
+
+#include <vector>
+#include <span>
+#include <optional>
+#include <cstddef>
+
+#include "BinaryFIn.hh"
+#include "BinaryFOut.hh"
+#include "LZWHeader.hh"
+#include "LZWEncoder.hh"
+#include "LZWDecoder.hh"
+#include "LZW.hh"
+
+class LZWStreamEncoder{
+    private:
+        static const std::size_t WINDOW = 1 << 16; // Bytes taken from a BinaryFIn per update
+        LZWHeader header; // Mode of the stream, always a single codeword stream
+        std::vector<unsigned char> output; // Compressed bytes produced by the latest call
+        std::vector<unsigned char> window; // Input taken from a BinaryFIn
+        BinaryFOut sink; // Packs codewords into output
+        LZWEncoder encoder; // Dictionary and match carried across calls
+        bool finished; // Set once finish() has been called
+
+    public:
+        LZWStreamEncoder(); // Stream with the default settings
+        LZWStreamEncoder(LZWOptions options); // Stream with compression settings (block_size, sync_interval and huffman are ignored)
+        LZWStreamEncoder(const LZWStreamEncoder&) = delete;
+        LZWStreamEncoder& operator=(const LZWStreamEncoder&) = delete;
+        std::span<const unsigned char> update(std::span<const unsigned char> input); // Compress the next chunk
+        std::span<const unsigned char> finish(); // End the stream
+        void update(std::span<const unsigned char> input, BinaryFOut& out); // Compress the next chunk to out
+        void finish(BinaryFOut& out); // End the stream to out
+        std::size_t update(BinaryFIn& in, BinaryFOut& out); // Compress the next chunk of in to out
+};
+
+class LZWStreamDecoder{
+    private:
+        static const std::size_t WINDOW = 1 << 16; // Bytes taken from a BinaryFIn per update
+        std::vector<unsigned char> input; // Bytes received but not fully decoded
+        std::size_t skip; // Bits at the front of input already decoded
+        std::vector<unsigned char> output; // Expanded bytes produced by the latest call
+        std::vector<unsigned char> window; // Input taken from a BinaryFIn
+        BinaryFIn reader; // Reads codewords from input
+        BinaryFOut sink; // Collects expanded bytes in output
+        std::optional<LZWDecoder> decoder; // Created once the whole header has arrived
+        const LZWDictionary* dictionary; // Trained dictionary the stream needs, nullptr for none
+
+    public:
+        LZWStreamDecoder();
+        LZWStreamDecoder(const LZWDictionary* dictionary); // Stream compressed with a trained dictionary
+        LZWStreamDecoder(const LZWStreamDecoder&) = delete;
+        LZWStreamDecoder& operator=(const LZWStreamDecoder&) = delete;
+        std::span<const unsigned char> update(std::span<const unsigned char> chunk); // Expand the next chunk
+        void update(std::span<const unsigned char> chunk, BinaryFOut& out); // Expand the next chunk to out
+        std::size_t update(BinaryFIn& in, BinaryFOut& out); // Expand the next chunk of in to out
+        void finish(); // Check the stream ended
+        bool done(); // Whether the end of the stream has arrived
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef ORDERED_PIPELINE
+#define ORDERED_PIPELINE
+
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstddef>
+
+template<class Read, class Work, class Write>
+void ordered_pipeline(std::size_t threads, Read read, Work work, Write write){
+    /**
+     * Runs numbered jobs on a pool of threads while consuming
+     * input and producing output strictly in job order
+     *
+     * read(index, in) -> bool
+     *  Fills in with job index's input, false once there are no more jobs
+     *  Called one job at a time, in index order
+     * work(index, in, out)
+     *  Fills out from in, called concurrently on the pool
+     * write(index, in, out)
+     *  Consumes a finished job, called on the calling thread in index order
+     *
+     * At most 2 * threads jobs are held at once, so memory stays bounded
+     * however many jobs there are
+     * The first exception thrown by any callback stops the pipeline
+     * and is rethrown once all threads have finished
+     *
+     * @param threads   Number of worker threads (at least 1)
+    */
+
+    struct Job{
+        std::vector<unsigned char> in; // Input filled by read
+        std::vector<unsigned char> out; // Output filled by work
+        bool done = false; // Set once work has finished
+    };
+
+    if(threads == 0) threads = 1;
+    const std::size_t window = 2 * threads; // Jobs read but not yet written
+
+    std::mutex m;
+    std::condition_variable cv;
+    std::map<std::size_t, Job> jobs; // Jobs read but not yet written, by index
+    std::size_t next_read = 0; // Index of the next job to read
+    std::size_t next_write = 0; // Index of the next job to write
+    bool no_more = false; // Set once read reports there are no more jobs
+    std::exception_ptr error; // First exception thrown by a callback
+
+    auto worker = [&](){
+        std::unique_lock<std::mutex> lock(m);
+        while(true){
+            cv.wait(lock, [&]{ return no_more || error || next_read - next_write < window; });
+            if(no_more || error) return;
+
+            /* Read under the lock so input is consumed in order */
+            const std::size_t index = next_read;
+            Job& job = jobs[index];
+            try{
+                if(!read(index, job.in)){
+                    no_more = true;
+                    jobs.erase(index);
+                    cv.notify_all();
+                    return;
+                }
+            }
+            catch(...){
+                error = std::current_exception();
+                jobs.erase(index);
+                cv.notify_all();
+                return;
+            }
+            next_read++;
+
+            /* Work without the lock, map nodes stay put as others are added */
+            lock.unlock();
+            try{
+                work(index, job.in, job.out);
+            }
+            catch(...){
+                lock.lock();
+                if(!error) error = std::current_exception();
+                cv.notify_all();
+                return;
+            }
+            lock.lock();
+            job.done = true;
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for(std::size_t t=0; t<threads; ++t) pool.emplace_back(worker);
+
+    /* Write finished jobs in order on this thread */
+    try{
+        std::unique_lock<std::mutex> lock(m);
+        while(true){
+            cv.wait(lock, [&]{
+                if(error) return true;
+                if(no_more && next_write == next_read) return true;
+                auto it = jobs.find(next_write);
+                return it != jobs.end() && it->second.done;
+            });
+            if(error || next_write == next_read) break;
+
+            Job& job = jobs.find(next_write)->second;
+            lock.unlock();
+            write(next_write, job.in, job.out);
+            lock.lock();
+            jobs.erase(next_write);
+            next_write++;
+            cv.notify_all();
+        }
+    }
+    catch(...){
+        std::lock_guard<std::mutex> lock(m);
+        if(!error) error = std::current_exception();
+        cv.notify_all();
+    }
+
+    for(auto& t : pool) t.join();
+    if(error) std::rethrow_exception(error);
+}
+
+#endif
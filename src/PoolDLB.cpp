@@ -0,0 +1,97 @@
+/**
+ * Implementation of a fixed-capacity, pooled DLB Trie
+ *
+ * Offers the node-level interface of ArenaDLB, but every key has
+ * its own node, at the key plus one, in a pool sized once for the
+ * largest dictionary, so building the trie never allocates
+ * A node is only its down link and its right link packed with
+ * its character, 8 bytes, and the pool is cache-line aligned, so
+ * a 4096 codeword trie is 32 KiB and a 65536 codeword one 512 KiB
+ * The first level is a direct table indexed by character
+ * A node is written whole when its key is added, so clearing
+ * only empties the first level, and restoring a trained trie
+ * copies only the lines its keys occupy
+*/
+#include <algorithm>
+#include <stdexcept>
+#include "PoolDLB.hh"
+
+PoolDLB::PoolDLB() : PoolDLB(1 << 12){
+}
+
+PoolDLB::PoolDLB(std::size_t capacity){
+    /**
+     * Initialize an empty trie with a node for
+     * each of the keys 0 to capacity-1
+     *
+     * @param capacity  Number of keys to size the pool for
+     * @throws invalid_argument if capacity is larger than MAX_KEY + 1
+    */
+
+    if(capacity > MAX_KEY + std::size_t(1)){
+        throw(std::invalid_argument("Dictionary capacity too large"));
+    }
+
+    pool.resize((capacity + 1 + NODES_PER_LINE - 1) / NODES_PER_LINE); // One more for NIL
+    clear();
+}
+
+void PoolDLB::clear(){
+    /**
+     * Removes every string from the trie
+     * Nodes are only reachable through the first level, so this
+     * is O(1) (plus clearing the fixed 256 entry first level)
+     * and the pool is kept for reuse
+    */
+
+    std::fill(roots, roots + 256, NIL);
+    count = 0;
+}
+
+void PoolDLB::seal(){
+    /**
+     * Finds the highest node in use, for restore()
+     * Walks every node reachable from the first level once, so it
+     * is for a trie built once and restored from many times;
+     * nothing is added after it
+    */
+
+    top = NIL;
+    std::vector<uint32_t> stack(roots, roots + 256);
+    while(!stack.empty()){
+        const uint32_t node = stack.back();
+        stack.pop_back();
+        if(node == NIL) continue;
+        top = std::max(top, node);
+        stack.push_back(at(node).down);
+        stack.push_back(at(node).link >> 8);
+    }
+}
+
+void PoolDLB::restore(const PoolDLB& primed){
+    /**
+     * Replaces every string with the strings of primed
+     * Copies only the lines up to primed's highest node, so the
+     * cost follows the keys primed holds, not the pool's size
+     *
+     * @param primed    Trie to copy the strings of, sealed after
+     *  its last string was added
+     * @throws invalid_argument if primed's pool is a different size
+    */
+
+    if(primed.pool.size() != pool.size()){
+        throw(std::invalid_argument("Dictionary capacities differ"));
+    }
+
+    std::copy(primed.pool.begin(), primed.pool.begin() + primed.top / NODES_PER_LINE + 1, pool.begin());
+    std::copy(primed.roots, primed.roots + 256, roots);
+    count = primed.count;
+}
+
+std::size_t PoolDLB::size(){
+    /**
+     * @returns Number of strings in the trie
+    */
+
+    return count;
+}
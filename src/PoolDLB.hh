@@ -0,0 +1,146 @@
+#ifndef POOL_DLB_COMP
+#define POOL_DLB_COMP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+#include "LZWStats.hh"
+
+class PoolDLB{
+    private:
+        struct DLB_Node{
+            /**
+             * Private struct for the nodes of the trie, 8 bytes each
+             * A node is its string's key plus one, so the key is not
+             * stored and every link is an index into the pool
+            */
+
+            uint32_t down; // Node of the first child (NIL if none)
+            uint32_t link; // (node of the right sibling << 8) | character
+        };
+        struct alignas(64) Line{
+            /**
+             * Private struct for one cache line of the pool
+            */
+
+            DLB_Node node[8];
+        };
+        static constexpr int NODES_PER_LINE = 8;
+        std::vector<Line> pool; // Nodes for keys 0 to capacity-1, index 0 reserved, allocated once
+        uint32_t roots[256]; // First level of the trie, indexed directly by character
+        std::size_t count; // Number of strings stored
+        uint32_t top = NIL; // Highest node in use when seal() was last called
+        uint64_t visits = 0; // Nodes looked at by child(), counted only if LZW_STATS_ENABLED
+        DLB_Node& at(uint32_t node); // Node by index
+
+    public:
+        static constexpr uint32_t NIL = 0; // Index 0 is reserved, no node is stored there
+        static const uint32_t MAX_KEY = (1u << 24) - 2; // Largest key that can be stored
+        PoolDLB();
+        PoolDLB(std::size_t capacity); // Pool for keys 0 to capacity-1
+        void clear(); // Remove every string, keeping the pool
+        void seal(); // Find the highest node in use, so restore() from this trie copies only up to it
+        void restore(const PoolDLB& primed); // Hold exactly the strings of a sealed trie of the same capacity
+        std::size_t size(); // Number of strings stored
+
+        /* Node-level access for walking the trie one character at a time */
+        uint32_t child(uint32_t node, char c); // Child of node for c (NIL node is the first level)
+        uint32_t add_child(uint32_t node, char c, int key); // Insert c below node with key
+        int key_of(uint32_t node); // Key stored at node
+        uint64_t visited(); // Nodes looked at by child() so far, with LZW_STATS
+};
+
+/* Node-level members are inline so encoders walking the trie inline them */
+
+inline PoolDLB::DLB_Node& PoolDLB::at(uint32_t node){
+    /**
+     * Private member finding a node in the pool
+     * Lines are exactly 64 bytes, so this is a single indexed load
+     *
+     * @param node  Index of the node
+     * @returns The node
+    */
+
+    return pool[node / NODES_PER_LINE].node[node % NODES_PER_LINE];
+}
+
+inline uint32_t PoolDLB::child(uint32_t node, char c){
+    /**
+     * Finds the node for character c directly below the given node
+     *
+     * @param node  Index of the node to descend from, NIL for the first level
+     * @param c Character to look for
+     * @returns Index of the child node, NIL if there is none
+    */
+
+    if constexpr(LZW_STATS_ENABLED) visits++;
+    if(node == NIL) return roots[static_cast<unsigned char>(c)];
+
+    const uint32_t ch = static_cast<unsigned char>(c);
+    uint32_t traverse = at(node).down;
+    while(traverse != NIL){
+        const uint32_t link = at(traverse).link;
+        if((link & 0xff) == ch) break;
+        traverse = link >> 8;
+        if constexpr(LZW_STATS_ENABLED) visits++;
+    }
+    return traverse;
+}
+
+inline uint32_t PoolDLB::add_child(uint32_t node, char c, int key){
+    /**
+     * Inserts character c directly below the given node and
+     * maps the resulting string to key
+     * Assumes the child does not already exist (child() returned NIL)
+     * and that every key is stored at most once between clears,
+     * so the key's node is free; it is linked at the front of the
+     * down list, and nothing is allocated
+     *
+     * @param node  Index of the node to insert below, NIL for the first level
+     * @param c Character to insert
+     * @param key   Key to map the new string to, below the capacity
+     * @returns Index of the new node
+    */
+
+    const uint32_t added = static_cast<uint32_t>(key) + 1;
+    const uint32_t ch = static_cast<unsigned char>(c);
+    DLB_Node& n = at(added);
+    n.down = NIL;
+
+    if(node == NIL){
+        n.link = (NIL << 8) | ch;
+        roots[ch] = added;
+    }
+    else{
+        DLB_Node& parent = at(node);
+        n.link = (parent.down << 8) | ch;
+        parent.down = added;
+    }
+
+    count++;
+    return added;
+}
+
+inline int PoolDLB::key_of(uint32_t node){
+    /**
+     * @param node  Index of a node returned by child() or add_child()
+     * @returns Key stored at the node
+     * @throws invalid_argument for the NIL node
+    */
+
+    if(node == NIL) throw std::invalid_argument("No key at node");
+    return static_cast<int>(node - 1);
+}
+
+inline uint64_t PoolDLB::visited(){
+    /**
+     * @returns Number of nodes child() has looked at, across clears;
+     *  always 0 unless LZW_STATS_ENABLED
+    */
+
+    return visits;
+}
+
+#endif
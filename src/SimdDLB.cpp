@@ -0,0 +1,254 @@
+/**
+ * Implementation of a DLB Trie with packed, vector-searched children
+ *
+ * Same interface and semantics as ArenaDLB, but instead of a linked
+ * list of siblings every node keeps the characters of its children
+ * packed side by side, so finding a child is one vector compare and
+ * movemask over up to 16 (SSE2) or 32 (AVX2) characters rather than
+ * a chain of dependent loads
+ * Wide nodes, common on binary input, use AVX2 when the CPU
+ * supports it, checked once at runtime, and SSE2 otherwise;
+ * builds for CPUs without SSE2 search with a scalar loop
+ * Clearing the trie keeps all storage for reuse
+*/
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "SimdDLB.hh"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_DLB_X86
+#endif
+
+enum class Search{SCALAR, SSE2, AVX2};
+
+static Search detect_search(){
+    /**
+     * @returns Widest child search the running CPU supports
+    */
+
+#if defined(SIMD_DLB_X86)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) return Search::AVX2;
+#endif
+#if defined(__SSE2__)
+    return Search::SSE2;
+#else
+    return Search::SCALAR;
+#endif
+}
+
+static const Search SEARCH = detect_search(); // Picked once at startup
+
+#if defined(SIMD_DLB_X86)
+__attribute__((target("avx2")))
+static int find_avx2(const unsigned char* p, int count, unsigned char c){
+    /**
+     * Finds c among count packed characters 32 at a time
+     *
+     * @param p Packed characters, readable up to 32 bytes past count
+     * @param count Number of characters
+     * @param c Character to find
+     * @returns Position of c, -1 if it is not there
+    */
+
+    const __m256i key = _mm256_set1_epi8(static_cast<char>(c));
+    for(int i=0; i<count; i+=32){
+        const __m256i hit = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), key);
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+        if(count - i < 32) mask &= (1u << (count - i)) - 1;
+        if(mask != 0) return i + __builtin_ctz(mask);
+    }
+    return -1;
+}
+#endif
+
+int SimdDLB::find_wide(const unsigned char* p, int count, unsigned char c){
+    /**
+     * Private member finding c among more than 16 packed characters
+     * with the search picked for the running CPU
+     *
+     * @param p Packed characters, readable for PAD bytes past count
+     * @param count Number of characters
+     * @param c Character to find
+     * @returns Position of c, -1 if it is not there
+    */
+
+#if defined(SIMD_DLB_X86)
+    if(SEARCH == Search::AVX2) return find_avx2(p, count, c);
+#endif
+#if defined(__SSE2__)
+    if(SEARCH == Search::SSE2){
+        const __m128i key = _mm_set1_epi8(static_cast<char>(c));
+        for(int i=0; i<count; i+=16){
+            const __m128i hit = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), key);
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+            if(count - i < 16) mask &= (1u << (count - i)) - 1;
+            if(mask != 0) return i + __builtin_ctz(mask);
+        }
+        return -1;
+    }
+#endif
+    for(int i=0; i<count; ++i){
+        if(p[i] == c) return i;
+    }
+    return -1;
+}
+
+const char* SimdDLB::search(){
+    /**
+     * @returns Name of the search used for nodes with more than
+     *  16 children: "avx2", "sse2" or "scalar"
+    */
+
+    switch(SEARCH){
+        case Search::AVX2: return "avx2";
+        case Search::SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+SimdDLB::SimdDLB(){
+    /**
+     * Initialize an empty trie
+    */
+
+    clear();
+}
+
+SimdDLB::SimdDLB(std::size_t capacity){
+    /**
+     * Initialize an empty trie and
+     * reserve room for capacity nodes so building the trie
+     * rarely reallocates
+     * Runs of children double as they fill, so the pools
+     * get room for about twice as many children as nodes
+     *
+     * @param capacity  Number of nodes to reserve
+    */
+
+    nodes.reserve(capacity + 1);
+    chars.reserve(2 * capacity + PAD);
+    kids.reserve(2 * capacity);
+    clear();
+}
+
+void SimdDLB::clear(){
+    /**
+     * Removes every string from the trie
+     * Nodes and children are trivially destructible, so this is O(1)
+     * (plus clearing the fixed 256 entry first level)
+     * and all storage is kept for reuse
+    */
+
+    nodes.clear();
+    nodes.push_back(DLB_Node{-1, 0, 0, 0}); // Reserve NIL
+    used = 0;
+    chars.assign(PAD, 0);
+    kids.clear();
+    std::fill(roots, roots + 256, NIL);
+}
+
+void SimdDLB::restore(const SimdDLB& primed){
+    /**
+     * Replaces every string with the strings of primed
+     * Only primed's nodes and the runs handed out for their
+     * children are copied, into this trie's storage, so with
+     * room for them nothing is allocated
+     *
+     * @param primed    Trie to copy the strings of
+    */
+
+    nodes.assign(primed.nodes.begin(), primed.nodes.end());
+    chars.assign(primed.chars.begin(), primed.chars.end());
+    kids.assign(primed.kids.begin(), primed.kids.end());
+    used = primed.used;
+    std::copy(primed.roots, primed.roots + 256, roots);
+}
+
+std::size_t SimdDLB::size(){
+    /**
+     * @returns Number of nodes in the trie
+    */
+
+    return nodes.size() - 1;
+}
+
+void SimdDLB::put(const std::string& s, int key){
+    /**
+     * Inserts given string into the trie and
+     * maps string to the given key
+     *
+     * @param s String to insert into trie
+     * @param key   Key to map string to in trie (not negative)
+    */
+
+    if(s.empty()) return;
+
+    uint32_t parent = NIL; // Node of the characters matched so far
+    for(const char ch : s){
+        uint32_t next = child(parent, ch);
+        if(next == NIL) next = add_child(parent, ch, -1);
+        parent = next;
+    }
+
+    nodes[parent].key = key;
+}
+
+void SimdDLB::put(char c, int key){
+    /**
+     * Overloaded member for inserting a single
+     * char into the trie with a given key
+     *
+     * @param c char to insert into trie
+     * @param key   Key (int) to map char to in trie
+    */
+
+    std::string s(1, c);
+    put(s, key);
+}
+
+std::string SimdDLB::longest_prefix_of(const std::string& s){
+    /**
+     * Given a string, returns longest string in trie
+     * that is a prefix of the given string
+     *
+     * @param s String to prefix match to
+     * @returns Longest string in trie that is a prefix of s
+    */
+
+    std::size_t length = 0; // Length of longest valid key seen so far
+    uint32_t traverse = NIL;
+
+    /* Descend one level per character until a character has no node */
+    for(std::size_t i=0; i<s.length(); ++i){
+        traverse = child(traverse, s[i]);
+        if(traverse == NIL) break;
+        if(nodes[traverse].key >= 0) length = i + 1;
+    }
+
+    return s.substr(0, length);
+}
+
+int SimdDLB::get(const std::string& s){
+    /**
+     * Fetches key of given string in trie
+     * Throws invalid_argument exception if s not
+     * in trie
+     *
+     * @param s String to retrieve key for
+     * @returns Key of given string
+     * @throws invalid_argument exception if s not in trie
+    */
+
+    uint32_t traverse = NIL;
+    for(const char ch : s){
+        traverse = child(traverse, ch);
+        if(traverse == NIL) throw std::invalid_argument("String not in trie");
+    }
+
+    if(traverse == NIL || nodes[traverse].key < 0) throw std::invalid_argument("String not in trie");
+    return nodes[traverse].key;
+}
@@ -0,0 +1,184 @@
+#ifndef SIMD_DLB_COMP
+#define SIMD_DLB_COMP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+#include "LZWStats.hh"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+class SimdDLB{
+    private:
+        struct DLB_Node{
+            /**
+             * Private struct for the nodes of the trie
+             * A node's children are a run of the shared pools: their
+             * characters packed side by side in chars and their node
+             * indices at the same positions in kids
+            */
+
+            int key; // Key of string ending at node, -1 if none
+            uint32_t base; // Position of the node's children in chars and kids
+            uint16_t count; // Number of children
+            uint16_t cap; // Room for children at base before the run must move
+        };
+        static const std::size_t PAD = 32; // Bytes readable past the last run by a vector load
+        std::vector<DLB_Node> nodes; // Contiguous storage for every node, index 0 reserved
+        std::vector<unsigned char> chars; // Child characters of every node, plus PAD
+        std::vector<uint32_t> kids; // Child node indices, in step with chars
+        std::size_t used; // Positions of chars and kids handed out to runs
+        uint32_t roots[256]; // First level of the trie, indexed directly by character
+        uint64_t visits = 0; // Nodes looked at by child(), counted only if LZW_STATS_ENABLED
+        uint32_t new_node(); // Append a node with no key and no children
+        static int find_wide(const unsigned char* p, int count, unsigned char c);
+        static int find(const unsigned char* p, int count, unsigned char c);
+
+    public:
+        static constexpr uint32_t NIL = 0; // Index 0 is reserved, no node is stored there
+        SimdDLB();
+        SimdDLB(std::size_t capacity); // Reserve room for capacity nodes up front
+        void put(const std::string& s, int key); // Put s into trie with key
+        void put(char c, int key); // Put c into trie with key
+        std::string longest_prefix_of(const std::string& s); // Prefix match with string s
+        int get(const std::string& s); // Get key for string s
+        void clear(); // Remove every string, keeping the storage
+        void restore(const SimdDLB& primed); // Hold exactly primed's strings, reusing the storage
+        std::size_t size(); // Number of nodes in the trie
+        static const char* search(); // Name of the child search picked for this CPU
+
+        /* Node-level access for walking the trie one character at a time */
+        uint32_t child(uint32_t node, char c); // Child of node for c (NIL node is the first level)
+        uint32_t add_child(uint32_t node, char c, int key); // Insert c below node with key
+        int key_of(uint32_t node); // Key stored at node
+        uint64_t visited(); // Nodes looked at by child() so far, with LZW_STATS
+};
+
+/* Node-level members are inline so encoders walking the trie inline them */
+
+inline int SimdDLB::find(const unsigned char* p, int count, unsigned char c){
+    /**
+     * Private member finding c among count packed characters
+     * Up to 16 characters, the usual case, take one SSE2 compare
+     * and movemask; longer runs go to find_wide, which uses
+     * AVX2 when the CPU has it
+     *
+     * @param p Packed characters, readable for PAD bytes past count
+     * @param count Number of characters
+     * @param c Character to find
+     * @returns Position of c, -1 if it is not there
+    */
+
+    if(count > 16) return find_wide(p, count, c);
+#if defined(__SSE2__)
+    const __m128i hit = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+        _mm_set1_epi8(static_cast<char>(c)));
+    const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit)) & ((1u << count) - 1);
+    return mask != 0 ? __builtin_ctz(mask) : -1;
+#else
+    for(int i=0; i<count; ++i){
+        if(p[i] == c) return i;
+    }
+    return -1;
+#endif
+}
+
+inline uint32_t SimdDLB::new_node(){
+    /**
+     * Private member that appends a node with no key
+     * and no children to the arena
+     *
+     * @returns Index of the new node
+    */
+
+    nodes.push_back(DLB_Node{-1, 0, 0, 0});
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+inline uint32_t SimdDLB::child(uint32_t node, char c){
+    /**
+     * Finds the node for character c directly below the given node
+     * by searching the node's packed child characters at once
+     *
+     * @param node  Index of the node to descend from, NIL for the first level
+     * @param c Character to look for
+     * @returns Index of the child node, NIL if there is none
+    */
+
+    if constexpr(LZW_STATS_ENABLED) visits++;
+    if(node == NIL) return roots[static_cast<unsigned char>(c)];
+
+    const DLB_Node& n = nodes[node];
+    const int i = find(chars.data() + n.base, n.count, static_cast<unsigned char>(c));
+    return i < 0 ? NIL : kids[n.base + i];
+}
+
+inline uint32_t SimdDLB::add_child(uint32_t node, char c, int key){
+    /**
+     * Inserts character c directly below the given node and
+     * maps the resulting string to key
+     * Assumes the child does not already exist (child() returned NIL)
+     * A full run of children moves to the end of the pools with twice
+     * the room; the old run is reclaimed only by clear()
+     *
+     * @param node  Index of the node to insert below, NIL for the first level
+     * @param c Character to insert
+     * @param key   Key to map the new string to
+     * @returns Index of the new node
+    */
+
+    uint32_t added = new_node();
+    nodes[added].key = key;
+
+    if(node == NIL){
+        roots[static_cast<unsigned char>(c)] = added;
+        return added;
+    }
+
+    DLB_Node& n = nodes[node];
+    if(n.count == n.cap){
+        const uint16_t cap = n.cap == 0 ? 2 : static_cast<uint16_t>(2 * n.cap);
+        const std::size_t base = used;
+        used += cap;
+        chars.resize(used + PAD);
+        kids.resize(used);
+        for(uint16_t i=0; i<n.count; ++i){
+            chars[base + i] = chars[n.base + i];
+            kids[base + i] = kids[n.base + i];
+        }
+        n.base = static_cast<uint32_t>(base);
+        n.cap = cap;
+    }
+
+    chars[n.base + n.count] = static_cast<unsigned char>(c);
+    kids[n.base + n.count] = added;
+    n.count++;
+    return added;
+}
+
+inline int SimdDLB::key_of(uint32_t node){
+    /**
+     * @param node  Index of a node returned by child() or add_child()
+     * @returns Key stored at the node
+     * @throws invalid_argument if no string ends at the node
+    */
+
+    if(node == NIL || nodes[node].key < 0) throw std::invalid_argument("No key at node");
+    return nodes[node].key;
+}
+
+inline uint64_t SimdDLB::visited(){
+    /**
+     * @returns Number of nodes whose children child() has searched,
+     *  across clears; always 0 unless LZW_STATS_ENABLED
+    */
+
+    return visits;
+}
+
+#endif
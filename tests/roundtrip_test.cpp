@@ -0,0 +1,445 @@
+/**
+ * Round trip and corrupt input tests, run by ctest
+ *
+ * Compresses generated inputs with every dictionary backend in
+ * every mode (one stream, blocks, sync points, Huffman coding, a
+ * trained dictionary and flexible parsing) and checks that each
+ * expands back to the input, and that all backends write the
+ * same bytes
+ * Checks that LZWStreamEncoder and LZWContext write the same bytes
+ * as LZW::compress for one stream, and that truncated or damaged
+ * files, including indexes claiming impossible sizes, are rejected
+ *
+ * Exit status is 0 if every check passes, 1 otherwise
+*/
+
+#include <string>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <functional>
+#include <stdexcept>
+#include <new>
+#include <cstdint>
+#include <cstring>
+
+#include "LZW.hh"
+#include "LZWStream.hh"
+#include "LZWContext.hh"
+
+static int failures = 0; // Number of failed checks
+
+static void check(bool ok, const std::string& what){
+    /**
+     * Records a check, printing it if it failed
+     *
+     * @param ok    Whether the check passed
+     * @param what  Description of the check
+    */
+
+    if(ok) return;
+    std::cerr << "FAILED: " << what << "\n";
+    failures++;
+}
+
+static void check_throws(const std::function<void()>& f, const std::string& what){
+    /**
+     * Checks that f rejects its input with an exception
+     * rather than returning, or trying to allocate for it
+     *
+     * @param f     Call that should throw
+     * @param what  Description of the check
+    */
+
+    try{
+        f();
+    }
+    catch(const std::bad_alloc&){
+        check(false, what + " ran out of memory");
+        return;
+    }
+    catch(const std::exception&){
+        return;
+    }
+    check(false, what + " was accepted");
+}
+
+static std::vector<std::byte> make_text(std::size_t size, unsigned seed){
+    /**
+     * @param size  Number of bytes
+     * @param seed  Seed for the word choice
+     * @returns English-like words separated by spaces
+    */
+
+    static const char* words[] = {
+        "the", "of", "and", "to", "in", "a", "is", "that", "for", "it",
+        "as", "was", "with", "be", "by", "on", "not", "he", "this", "are",
+        "compression", "dictionary", "codeword", "trie", "prefix", "string"
+    };
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> pick(0, sizeof(words)/sizeof(words[0]) - 1);
+    std::vector<std::byte> data;
+    while(data.size() < size){
+        for(const char* w = words[pick(gen)]; *w; ++w) data.push_back(std::byte(*w));
+        data.push_back(std::byte(' '));
+    }
+    data.resize(size);
+    return data;
+}
+
+static std::vector<std::byte> make_random(std::size_t size){
+    /**
+     * @param size  Number of bytes
+     * @returns Uniform random bytes, which fill the dictionary fastest
+    */
+
+    std::mt19937 gen(7);
+    std::vector<std::byte> data(size);
+    for(std::byte& b : data) b = std::byte(gen());
+    return data;
+}
+
+static std::vector<std::byte> to_bytes(std::span<const std::byte> data){
+    return std::vector<std::byte>(data.begin(), data.end());
+}
+
+struct Mode{
+    std::string name;
+    LZWOptions options;
+};
+
+static std::vector<Mode> modes(const LZWDictionary& dictionary){
+    /**
+     * @param dictionary    Trained dictionary for the modes using one
+     * @returns Every mode to test, each with 2 threads
+    */
+
+    std::vector<Mode> all;
+    auto add = [&](const std::string& name, auto set){
+        LZWOptions options;
+        options.threads = 2;
+        set(options);
+        all.push_back({name, options});
+    };
+
+    add("stream", [](LZWOptions& o){ o.block_size = 0; });
+    add("stream 9 bits", [](LZWOptions& o){ o.block_size = 0; o.max_width = 9; });
+    add("stream 12 bits frozen", [](LZWOptions& o){ o.block_size = 0; o.max_width = 12; o.reset = false; });
+    add("fixed 12 bits", [](LZWOptions& o){ o.block_size = 0; o.min_width = 12; o.max_width = 12; });
+    add("blocks", [](LZWOptions& o){ o.block_size = 1 << 16; });
+    add("blocks 20 bits", [](LZWOptions& o){ o.block_size = 1 << 16; o.max_width = 20; });
+    add("sync", [](LZWOptions& o){ o.block_size = 0; o.max_width = 12; o.sync_interval = 1000; });
+    add("huffman", [](LZWOptions& o){ o.block_size = 1 << 16; o.huffman = true; });
+    add("huffman 12 bits", [](LZWOptions& o){ o.block_size = 1 << 16; o.huffman = true; o.max_width = 12; });
+    add("dictionary stream", [&](LZWOptions& o){ o.block_size = 0; o.max_width = 12; o.dictionary = &dictionary; });
+    add("dictionary blocks", [&](LZWOptions& o){ o.block_size = 1 << 16; o.max_width = 12; o.dictionary = &dictionary; });
+    add("effort", [](LZWOptions& o){ o.block_size = 0; o.effort = 4; });
+    add("effort blocks 12 bits", [](LZWOptions& o){ o.block_size = 1 << 16; o.max_width = 12; o.effort = 16; });
+    return all;
+}
+
+template<class Dict>
+static std::vector<std::byte> round_trip(const std::string& backend, const Mode& mode,
+    const std::string& input, std::span<const std::byte> data){
+    /**
+     * Compresses data in one mode and checks it expands back
+     *
+     * @param backend   Name of Dict, for messages
+     * @param mode  Settings to compress with
+     * @param input Name of data, for messages
+     * @param data  Bytes to compress
+     * @returns The compressed bytes
+    */
+
+    const std::string what = backend + " " + mode.name + " " + input;
+    std::vector<std::byte> compressed;
+    try{
+        compressed = BasicLZW<Dict>::compress(data, mode.options);
+        const std::vector<std::byte> expanded = BasicLZW<Dict>::expand(compressed, 2, mode.options.dictionary);
+        check(expanded == to_bytes(data), what + " round trip");
+
+        std::vector<std::byte> out(data.size());
+        const std::size_t n = BasicLZW<Dict>::expand(compressed, out, 2, mode.options.dictionary);
+        check(n == data.size() && out == to_bytes(data), what + " round trip into a buffer");
+    }
+    catch(const std::exception& e){
+        check(false, what + " threw " + e.what());
+    }
+    return compressed;
+}
+
+template<class Dict>
+static void identical_streams(const std::string& backend, const LZWOptions& options,
+    const std::string& input, std::span<const std::byte> data){
+    /**
+     * Checks that a stream encoder fed in uneven chunks and a reused
+     * context write the same bytes as LZW::compress for one stream,
+     * and that the stream decoder and context expand them back
+     *
+     * @param backend   Name of Dict, for messages
+     * @param options   One stream settings
+     * @param input Name of data, for messages
+     * @param data  Bytes to compress
+    */
+
+    const std::string what = backend + " " + input;
+    const std::vector<std::byte> whole = BasicLZW<Dict>::compress(data, options);
+    const std::span<const unsigned char> bytes(reinterpret_cast<const unsigned char*>(data.data()), data.size());
+
+    LZWStreamEncoder encoder(options);
+    std::vector<unsigned char> streamed;
+    for(std::size_t at = 0, chunk = 1; at < bytes.size(); at += chunk, chunk = chunk * 3 + 1){
+        const std::span<const unsigned char> out = encoder.update(bytes.subspan(at, std::min(chunk, bytes.size() - at)));
+        streamed.insert(streamed.end(), out.begin(), out.end());
+    }
+    const std::span<const unsigned char> last = encoder.finish();
+    streamed.insert(streamed.end(), last.begin(), last.end());
+    check(streamed.size() == whole.size() && std::memcmp(streamed.data(), whole.data(), whole.size()) == 0,
+        what + " stream encoder matches LZW::compress");
+
+    LZWStreamDecoder decoder(options.dictionary);
+    std::vector<unsigned char> expanded;
+    for(std::size_t at = 0; at < streamed.size(); at += 1000){
+        const std::span<const unsigned char> out = decoder.update(
+            std::span<const unsigned char>(streamed).subspan(at, std::min<std::size_t>(1000, streamed.size() - at)));
+        expanded.insert(expanded.end(), out.begin(), out.end());
+    }
+    decoder.finish();
+    check(expanded.size() == bytes.size() && std::equal(expanded.begin(), expanded.end(), bytes.begin()),
+        what + " stream decoder round trip");
+
+    BasicLZWContext<Dict> context(options);
+    for(int message = 0; message < 2; message++){
+        const std::vector<std::byte> compressed = to_bytes(context.compress(data));
+        check(compressed == whole, what + " context matches LZW::compress, message " + std::to_string(message));
+        check(to_bytes(context.expand(compressed)) == to_bytes(data), what + " context round trip");
+    }
+}
+
+template<class Dict>
+static void test_backend(const std::string& backend, const std::vector<Mode>& all,
+    const std::vector<std::pair<std::string, std::vector<std::byte>>>& inputs,
+    const LZWDictionary& dictionary, std::vector<std::vector<std::byte>>& reference){
+    /**
+     * Runs every mode on every input with one backend
+     *
+     * @param backend   Name of Dict, for messages
+     * @param all   Modes to test
+     * @param inputs    Named inputs
+     * @param dictionary    Trained dictionary for the stream checks
+     * @param reference Output of the first backend tested, filled by it,
+     *  which every other backend must match
+    */
+
+    const bool first = reference.empty();
+    std::size_t k = 0;
+    for(const Mode& mode : all){
+        for(const auto& [name, data] : inputs){
+            const std::vector<std::byte> compressed = round_trip<Dict>(backend, mode, name, data);
+            if(first) reference.push_back(compressed);
+            else check(compressed == reference[k], backend + " " + mode.name + " " + name + " matches LZW");
+            k++;
+        }
+    }
+
+    for(const auto& [name, data] : inputs){
+        LZWOptions options;
+        options.block_size = 0;
+        identical_streams<Dict>(backend, options, name, data);
+        options.max_width = 12;
+        options.dictionary = &dictionary;
+        identical_streams<Dict>(backend, options, name + " with dictionary", data);
+    }
+
+    /**
+     * Every message restores the trained entries, and after 254 of
+     * them a HashDict runs out of generations, so a context must keep
+     * matching LZW::compress across many messages
+    */
+    LZWOptions options;
+    options.block_size = 0;
+    options.max_width = 12;
+    options.dictionary = &dictionary;
+    BasicLZWContext<Dict> context(options);
+    const std::vector<std::byte>& text = inputs[3].second;
+    bool same = true;
+    for(std::size_t message = 0; message < 600 && same; message++){
+        const std::span<const std::byte> data(text.data() + message * 400, 300 + message % 200);
+        const std::vector<std::byte> compressed = to_bytes(context.compress(data));
+        same = compressed == BasicLZW<Dict>::compress(data, options)
+            && to_bytes(context.expand(compressed)) == to_bytes(data);
+    }
+    check(same, backend + " context with dictionary matches LZW::compress for 600 messages");
+}
+
+static void put64(std::vector<std::byte>& file, std::size_t at, uint64_t value){
+    /**
+     * Overwrites an 8-byte big-endian field of a file
+    */
+
+    for(int i = 0; i < 8; i++) file[at + i] = std::byte(value >> (56 - 8 * i));
+}
+
+static uint64_t get64(const std::vector<std::byte>& file, std::size_t at){
+    /**
+     * @returns The 8-byte big-endian field at at
+    */
+
+    uint64_t value = 0;
+    for(int i = 0; i < 8; i++) value = (value << 8) | std::to_integer<uint64_t>(file[at + i]);
+    return value;
+}
+
+static void test_corrupt(const std::vector<std::byte>& data, const LZWDictionary& dictionary){
+    /**
+     * Checks that damaged files are rejected, not expanded
+     * into garbage or allowed to allocate without bound
+     *
+     * @param data  Input to compress before damaging it
+     * @param dictionary    Trained dictionary for the dictionary case
+    */
+
+    LZWOptions stream;
+    stream.block_size = 0;
+    LZWOptions blocks;
+    blocks.block_size = 1 << 14;
+    LZWOptions sync;
+    sync.block_size = 0;
+    sync.sync_interval = 500;
+
+    const std::pair<std::string, LZWOptions> files[] = {{"stream", stream}, {"blocks", blocks}, {"sync", sync}};
+    for(const auto& [name, options] : files){
+        const std::vector<std::byte> good = LZW::compress(data, options);
+        for(std::size_t cut : {std::size_t(0), std::size_t(3), good.size() / 2, good.size() - 1}){
+            std::vector<std::byte> bad(good.begin(), good.begin() + cut);
+            check_throws([&]{ LZW::expand(bad, 2); }, name + " cut to " + std::to_string(cut) + " bytes");
+        }
+
+        std::vector<std::byte> bad = good;
+        bad[0] ^= std::byte(0xff);
+        check_throws([&]{ LZW::expand(bad, 2); }, name + " with a damaged magic number");
+    }
+
+    /* Trailer counts and index entries claiming more than the file could hold */
+    const std::vector<std::byte> good_blocks = LZW::compress(data, blocks);
+    const std::size_t trailer = good_blocks.size() - LZWBlockIndex::TRAILER_SIZE;
+    const uint64_t index = get64(good_blocks, trailer);
+    {
+        std::vector<std::byte> bad = good_blocks;
+        put64(bad, trailer + 8, uint64_t(1) << 60);
+        check_throws([&]{ LZW::expand(bad, 2); }, "block index with an impossible count");
+    }
+    {
+        std::vector<std::byte> bad = good_blocks;
+        put64(bad, index + 16, uint64_t(1) << 40);
+        check_throws([&]{ LZW::expand(bad, 2); }, "block index entry with an impossible raw size");
+    }
+    const std::vector<std::byte> good_sync = LZW::compress(data, sync);
+    const std::size_t sync_trailer = good_sync.size() - LZWSyncIndex::TRAILER_SIZE;
+    const uint64_t parts = get64(good_sync, sync_trailer + 8);
+    {
+        std::vector<std::byte> bad = good_sync;
+        put64(bad, sync_trailer + 8, uint64_t(1) << 60);
+        check_throws([&]{ LZW::expand(bad, 2); }, "sync index with an impossible count");
+    }
+    {
+        std::vector<std::byte> bad = good_sync;
+        const uint64_t sync_index = get64(bad, sync_trailer);
+        put64(bad, sync_index + (parts - 1) * 16 + 8, uint64_t(1) << 40);
+        check_throws([&]{ LZW::expand(bad, 2); }, "sync index entry with an impossible raw size");
+    }
+
+    /* A stream needs the dictionary it was compressed with */
+    LZWOptions trained = stream;
+    trained.max_width = 12;
+    trained.dictionary = &dictionary;
+    const std::vector<std::byte> good_trained = LZW::compress(data, trained);
+    check_throws([&]{ LZW::expand(good_trained, 2); }, "dictionary stream expanded without its dictionary");
+
+    /* Nothing may follow the EOF codeword of a stream, in the same chunk or a later one */
+    const std::vector<std::byte> good_stream = LZW::compress(data, stream);
+    std::vector<unsigned char> trailing(reinterpret_cast<const unsigned char*>(good_stream.data()),
+        reinterpret_cast<const unsigned char*>(good_stream.data()) + good_stream.size());
+    trailing.insert(trailing.end(), 4, 0x5a);
+    check_throws([&]{ LZWStreamDecoder decoder; decoder.update(trailing); }, "stream with data after EOF");
+    check_throws([&]{
+        LZWStreamDecoder decoder;
+        decoder.update(std::span<const unsigned char>(trailing).first(good_stream.size()));
+        decoder.update(std::span<const unsigned char>(trailing).last(4));
+    }, "stream with data after EOF in a later chunk");
+    check_throws([&]{
+        LZWStreamDecoder decoder;
+        decoder.update(std::span<const unsigned char>(trailing).first(good_stream.size() / 2));
+        decoder.finish();
+    }, "stream ending before EOF");
+}
+
+static void test_files(const std::vector<std::byte>& data){
+    /**
+     * Round trips through files, and expands ranges of a file
+     *
+     * @param data  Input to write, compress and expand
+    */
+
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "lzw_roundtrip_test";
+    std::filesystem::create_directories(dir);
+    const std::string input = (dir / "input.txt").string();
+    const std::string archive = (dir / "input.lzw").string();
+    const std::string output = (dir / "output.txt").string();
+    std::ofstream(input, std::ios::binary).write(reinterpret_cast<const char*>(data.data()), data.size());
+
+    try{
+        LZWOptions options;
+        options.block_size = 1 << 14;
+        LZW(input, options).compress(archive);
+        LZW(archive).expand(output);
+
+        std::ifstream in(output, std::ios::binary);
+        const std::string expanded((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        const std::string original(reinterpret_cast<const char*>(data.data()), data.size());
+        check(expanded == original, "file round trip");
+
+        LZW ranges(archive);
+        for(std::size_t offset : {std::size_t(0), std::size_t(1 << 14) - 10, data.size() - 100}){
+            check(ranges.expand_range(offset, 1000) == original.substr(offset, 1000),
+                "range at " + std::to_string(offset));
+        }
+    }
+    catch(const std::exception& e){
+        check(false, std::string("file round trip threw ") + e.what());
+    }
+    check_throws([&]{ LZW((dir / "missing.lzw").string()).expand_range(0, 10); }, "range of a missing file");
+
+    std::filesystem::remove_all(dir);
+}
+
+int main(){
+    const std::vector<std::byte> sample = make_text(1 << 16, 1);
+    const LZWDictionary dictionary = LZWDictionary::train(sample, 12);
+
+    std::vector<std::pair<std::string, std::vector<std::byte>>> inputs;
+    inputs.push_back({"empty", {}});
+    inputs.push_back({"one byte", {std::byte('x')}});
+    inputs.push_back({"run", std::vector<std::byte>(100000, std::byte('a'))});
+    inputs.push_back({"text", make_text(300000, 2)});
+    inputs.push_back({"random", make_random(100000)});
+
+    const std::vector<Mode> all = modes(dictionary);
+    std::vector<std::vector<std::byte>> reference;
+    test_backend<ArenaDLB>("LZW", all, inputs, dictionary, reference);
+    test_backend<HashDict>("HashLZW", all, inputs, dictionary, reference);
+    test_backend<SimdDLB>("SimdLZW", all, inputs, dictionary, reference);
+    test_backend<PoolDLB>("PoolLZW", all, inputs, dictionary, reference);
+
+    test_corrupt(inputs[3].second, dictionary);
+    test_files(inputs[3].second);
+
+    if(failures > 0){
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}